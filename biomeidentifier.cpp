@@ -7,6 +7,7 @@ Copyright (c) 2016, EtlamGit
 #include <cmath>
 
 #include "./biomeidentifier.h"
+#include "./blockidentifier.h"
 #include "./json.h"
 #include "./clamp.h"
 
@@ -201,13 +202,16 @@ BiomeIdentifier& BiomeIdentifier::Instance() {
   return singleton;
 }
 
-const BiomeInfo &BiomeIdentifier::getBiome(int biome) const {
-  auto itr = biomes.find(biome);
-  if (itr == biomes.end()) {
-    return unknownBiome;
-  } else {
-    return *(*itr);
-  }
+const BiomeInfo &BiomeIdentifier::getUnknownBiome() const {
+  return unknownBiome;
+}
+
+QList<const BiomeInfo*> BiomeIdentifier::getKnownBiomes() const {
+  QList<const BiomeInfo*> known;
+  for (const BiomeInfo *biome : biomes)
+    if (biome)
+      known.append(biome);
+  return known;
 }
 
 void BiomeIdentifier::setDefinitionsEnabled(int pack, bool enabled)
@@ -301,8 +305,13 @@ void BiomeIdentifier::updateBiomeDefinition()
   for (int pack = 0; pack < packs.length(); pack++)
     for (int i = 0; i < packs[pack].length(); i++) {
       BiomeInfo *bi = packs[pack][i];
-      if (bi->enabled) {
+      if (bi->enabled && bi->id >= 0) {
+        if (bi->id >= biomes.size())
+          biomes.resize(bi->id + 1);  // gaps are filled with NULL
         biomes[bi->id] = bi;
       }
     }
+
+  // tinted block colors are precomputed per biome
+  BlockIdentifier::Instance().invalidateRenderTable();
 }
@@ -4,8 +4,8 @@
 
 #include "identifierinterface.h"
 
-#include <QHash>
 #include <QList>
+#include <QVector>
 #include <QString>
 #include <QColor>
 class JSONArray;
@@ -52,7 +52,14 @@ class BiomeIdentifier: public IdentifierI {
   int addDefinitions(JSONArray *, int pack = -1) override;
   void setDefinitionsEnabled(int id, bool enabled) override;
   void updateBiomeDefinition();
-  const BiomeInfo &getBiome(int id) const;
+  const BiomeInfo &getBiome(int id) const {
+    // flat array lookup, this is done for every column during rendering
+    if (id >= 0 && id < biomes.size() && biomes[id])
+      return *biomes[id];
+    return getUnknownBiome();
+  }
+  const BiomeInfo &getUnknownBiome() const;
+  QList<const BiomeInfo*> getKnownBiomes() const;
 
 private:
   // singleton: prevent access to constructor and copyconstructor
@@ -61,7 +68,7 @@ private:
   BiomeIdentifier(const BiomeIdentifier &);
   BiomeIdentifier &operator=(const BiomeIdentifier &);
 
-  QHash<int, BiomeInfo*>    biomes;   // consolidated Biome mapping
+  QVector<BiomeInfo*>       biomes;   // consolidated Biome mapping, indexed by id
   QList<QList<BiomeInfo*> > packs;    // raw data of all available packs
 };
 
@@ -6,6 +6,8 @@
 #include <cmath>
 
 #include "./blockidentifier.h"
+#include "./biomeidentifier.h"
+#include "./flatteningconverter.h"
 #include "./json.h"
 
 static BlockInfo unknownBlock;
@@ -117,12 +119,34 @@ QList<quint32> BlockIdentifier::getKnownIds() const
     return blocks.keys();
 }
 
+BlockRenderTablePtr BlockIdentifier::getRenderTable()
+{
+    QMutexLocker locker(&renderTableMutex);
+    if (!renderTable) {
+      QSharedPointer<BlockRenderTable> table(new BlockRenderTable(unknownBlock));
+      for (auto it = blocks.cbegin(); it != blocks.cend(); ++it)
+        table->addBlock(it.key(), *it.value());
+      table->mapLegacyPalette(FlatteningConverter::Instance().getPalette(), 16*256);
+      table->addBiomes(BiomeIdentifier::Instance().getUnknownBiome(),
+                       BiomeIdentifier::Instance().getKnownBiomes());
+      renderTable = table;
+    }
+    return renderTable;
+}
+
+void BlockIdentifier::invalidateRenderTable()
+{
+    QMutexLocker locker(&renderTableMutex);
+    renderTable.reset();
+}
+
 void BlockIdentifier::setDefinitionsEnabled(int pack, bool enabled)
 {
     if (pack < 0) return;
     int len = packs[pack].length();
     for (int i = 0; i < len; i++)
       packs[pack][i]->enabled = enabled;
+    invalidateRenderTable();
 }
 
 int BlockIdentifier::addDefinitions(JSONArray *defs, int pack) {
@@ -133,6 +157,7 @@ int BlockIdentifier::addDefinitions(JSONArray *defs, int pack) {
   int len = defs->length();
   for (int i = 0; i < len; i++)
     parseDefinition(dynamic_cast<JSONObject *>(defs->at(i)), NULL, pack);
+  invalidateRenderTable();
   return pack;
 }
 
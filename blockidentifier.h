@@ -3,12 +3,14 @@
 #define BLOCKIDENTIFIER_H_
 
 #include "identifierinterface.h"
+#include "blockrendertable.h"
 
 #include <QString>
 #include <QMap>
 #include <QHash>
 #include <QList>
 #include <QColor>
+#include <QMutex>
 
 class JSONArray;
 class JSONObject;
@@ -81,6 +83,10 @@ class BlockIdentifier: public IdentifierI {
   bool       hasBlockInfo(uint hid);
 
   QList<quint32> getKnownIds() const;
+
+  // snapshot of all definitions for the renderer, rebuilt after definitions changed
+  BlockRenderTablePtr getRenderTable();
+  void invalidateRenderTable();
  private:
   // singleton: prevent access to constructor and copyconstructor
   BlockIdentifier();
@@ -91,6 +97,9 @@ class BlockIdentifier: public IdentifierI {
   void parseDefinition(JSONObject *block, BlockInfo *parent, int pack);
   QMap<uint, BlockInfo*>    blocks;
   QList<QList<BlockInfo*> > packs;
+
+  QMutex              renderTableMutex;
+  BlockRenderTablePtr renderTable;
 };
 
 #endif  // BLOCKIDENTIFIER_H_
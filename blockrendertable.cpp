@@ -0,0 +1,197 @@
+#include "./blockrendertable.h"
+#include "./biomeidentifier.h"
+#include "./blockidentifier.h"
+#include "./chunk.h"
+#include "./clamp.h"
+#include "./paletteentry.h"
+
+#include <cmath>
+
+namespace
+{
+  struct LightFactors
+  {
+    float factor[BlockRenderTable::LightLevels];
+
+    LightFactors()
+    {
+      for (int i = 0; i < BlockRenderTable::LightLevels; i++)
+      {
+        factor[i] = pow(0.90, 15 - (i + BlockRenderTable::MinLight));
+      }
+    }
+  };
+
+  const LightFactors s_lightFactors;
+}
+
+float BlockRenderTable::getLightFactor(int light)
+{
+  return s_lightFactors.factor[std::clamp(light, int(MinLight), int(MaxLight)) - MinLight];
+}
+
+BlockRenderTable::BlockRenderTable(const BlockInfo& unknownBlock)
+  : m_biomeSlotCount(0)
+{
+  m_entries.append(createEntry(unknownBlock));
+  m_blockIds.insert(&unknownBlock, 0);
+}
+
+void BlockRenderTable::addBlock(uint hid, const BlockInfo& block)
+{
+  auto it = m_blockIds.find(&block);
+  if (it == m_blockIds.end())
+  {
+    it = m_blockIds.insert(&block, static_cast<quint16>(m_entries.size()));
+    m_entries.append(createEntry(block));
+  }
+  m_denseIds.insert(hid, it.value());
+}
+
+void BlockRenderTable::mapLegacyPalette(const PaletteEntry* palette, int length)
+{
+  m_legacyDenseIds.resize(length);
+  for (int i = 0; i < length; i++)
+  {
+    m_legacyDenseIds[i] = getDenseId(palette[i].hid);
+  }
+}
+
+void BlockRenderTable::addBiomes(const BiomeInfo& unknownBiome, const QList<const BiomeInfo*>& biomes)
+{
+  QList<const BiomeInfo*> slots;
+  slots.append(&unknownBiome);
+  for (const BiomeInfo* biome : biomes)
+  {
+    if (biome->id < 0)
+    {
+      continue;
+    }
+    if (biome->id >= m_biomeSlots.size())
+    {
+      m_biomeSlots.resize(biome->id + 1);  // new elements are 0 -> unknown biome
+    }
+    m_biomeSlots[biome->id] = static_cast<quint16>(slots.size());
+    slots.append(biome);
+  }
+  m_biomeSlotCount = slots.size();
+
+  // blocks with the same color and kind of tint share their colors
+  QHash<quint64, qint16> tints;
+  for (Entry& entry : m_entries)
+  {
+    if ((entry.flags & BiomeTint) == 0)
+    {
+      continue;
+    }
+    const quint64 key = (static_cast<quint64>(entry.flags & BiomeTint) << 32) | entry.baseColor;
+    auto it = tints.find(key);
+    if (it != tints.end())
+    {
+      entry.tint = it.value();
+      continue;
+    }
+
+    entry.tint = static_cast<qint16>(m_tintColors.size() / (m_biomeSlotCount * ElevationBands * LightLevels));
+    tints.insert(key, entry.tint);
+
+    const QColor blockcolor = QColor::fromRgba(entry.baseColor);
+    for (const BiomeInfo* biome : slots)
+    {
+      for (int band = 0; band < ElevationBands; band++)
+      {
+        // center of the band, relative to sea level as used by Minecraft
+        const int elevation = band * ElevationBandHeight + ElevationBandHeight / 2 - 64;
+        QColor color;
+        if (entry.flags & BiomeWater)
+        {
+          color = biome->getBiomeWaterColor(blockcolor);
+        }
+        else if (entry.flags & BiomeGrass)
+        {
+          color = biome->getBiomeGrassColor(blockcolor, elevation);
+        }
+        else
+        {
+          color = biome->getBiomeFoliageColor(blockcolor, elevation);
+        }
+
+        for (int light = MinLight; light <= MaxLight; light++)
+        {
+          const float factor = getLightFactor(light);
+          m_tintColors.append(qRgb(std::clamp(int(factor * color.red()),   0, 255),
+                                   std::clamp(int(factor * color.green()), 0, 255),
+                                   std::clamp(int(factor * color.blue()),  0, 255)));
+        }
+      }
+    }
+  }
+}
+
+BlockRenderTable::Entry BlockRenderTable::createEntry(const BlockInfo& block)
+{
+  Entry entry;
+
+  const QColor& color = block.colors[15];
+  entry.baseColor = color.rgba();
+  entry.alpha = static_cast<float>(block.alpha);
+  entry.fixedAlpha = static_cast<quint16>(std::clamp(block.alpha, 0.0, 1.0) * FixedOne + 0.5);
+  if (entry.fixedAlpha == 0 && block.alpha > 0.0)
+  {
+    entry.fixedAlpha = 1;  // keep almost invisible blocks visible
+  }
+
+  for (int light = MinLight; light <= MaxLight; light++)
+  {
+    // same attenuation as BlockIdentifier, but the renderer also uses the levels outside of 0..15
+    const float factor = getLightFactor(light);
+    entry.colors[light - MinLight] = qRgba(std::clamp(int(factor * color.red()),   0, 255),
+                                           std::clamp(int(factor * color.green()), 0, 255),
+                                           std::clamp(int(factor * color.blue()),  0, 255),
+                                           color.alpha());
+  }
+
+  entry.flags = 0;
+  entry.tint = -1;
+  if (block.isLiquid())                     entry.flags |= Liquid;
+  if (block.transparent)                    entry.flags |= Transparent;
+  if (block.doesBlockHaveSolidTopSurface()) entry.flags |= SolidTop;
+  if (block.isBlockNormalCube())            entry.flags |= NormalCube;
+  if (block.spawninside)                    entry.flags |= SpawnInside;
+  if (block.isBedrock())                    entry.flags |= Bedrock;
+  // only one biome color is applied, in this order
+  if (block.biomeWater())                   entry.flags |= BiomeWater;
+  else if (block.biomeGrass())              entry.flags |= BiomeGrass;
+  else if (block.biomeFoliage())            entry.flags |= BiomeFoliage;
+
+  return entry;
+}
+
+
+quint16 BlockRenderLookup::getId(const ChunkSection& section, int sectionIndex, int offset, int y)
+{
+  const int index = section.blocks[offset + ((y & 0x0f) << 8)];
+
+  if (section.paletteLength == 0)
+  {
+    // pre-flattening chunk, linked to the palette of the FlatteningConverter
+    return m_table.getLegacyDenseId(index);
+  }
+
+  std::vector<qint32>& ids = m_sectionIds[sectionIndex];
+  if (ids.empty())
+  {
+    ids.assign(section.paletteLength, -1);
+  }
+  if (index >= section.paletteLength)
+  {
+    return 0;  // broken chunk data
+  }
+
+  qint32& id = ids[index];
+  if (id < 0)
+  {
+    id = m_table.getDenseId(section.palette[index].hid);
+  }
+  return static_cast<quint16>(id);
+}
@@ -0,0 +1,151 @@
+#ifndef BLOCKRENDERTABLE_H
+#define BLOCKRENDERTABLE_H
+
+#include <QColor>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <array>
+#include <vector>
+
+class BiomeInfo;
+class BlockInfo;
+class PaletteEntry;
+class ChunkSection;
+
+// Immutable snapshot of the block and biome definitions in the form the renderer needs them.
+//
+// Blocks are addressed by a dense id (index into the table) instead of their hashed name.
+// Each entry holds the block color already shaded for every light level the renderer can produce
+// and all attributes used during rendering as bit flags.
+// Blocks with biome dependent colors get their tinted colors per biome, elevation band and light level.
+class BlockRenderTable
+{
+public:
+  // light levels used by the renderer: 0..15 plus/minus 2 for the height difference shading
+  static const int MinLight = -2;
+  static const int MaxLight = 17;
+  static const int LightLevels = MaxLight - MinLight + 1;
+  static const int FixedOne = 1 << 15;
+
+  // grass and foliage colors change slowly with the elevation, a band shares one color
+  static const int ElevationBandHeight = 4;
+  static const int ElevationBands = 256 / ElevationBandHeight;
+
+  enum Flags : quint16
+  {
+    Liquid       = 0x0001,
+    Transparent  = 0x0002,
+    SolidTop     = 0x0004,  // BlockInfo::doesBlockHaveSolidTopSurface()
+    NormalCube   = 0x0008,  // BlockInfo::isBlockNormalCube()
+    SpawnInside  = 0x0010,
+    Bedrock      = 0x0020,
+    BiomeWater   = 0x0040,
+    BiomeGrass   = 0x0080,
+    BiomeFoliage = 0x0100,
+    BiomeTint    = BiomeWater | BiomeGrass | BiomeFoliage,
+  };
+
+  struct Entry
+  {
+    QRgb colors[LightLevels];  // index light - MinLight
+    QRgb baseColor;            // unshaded color incl. alpha, input for biome tinting
+    float alpha;
+    quint16 fixedAlpha;        // alpha * 2^15, for fixed-point blending and the layer index
+    quint16 flags;
+    qint16 tint;               // index of the biome tinted colors, -1 for untinted blocks
+
+    bool has(quint16 flag) const
+    {
+      return (flags & flag) != 0;
+    }
+
+    QRgb getColor(int light) const
+    {
+      return colors[light - MinLight];
+    }
+  };
+
+  // dense id 0 is always the unknown block
+  BlockRenderTable(const BlockInfo& unknownBlock);
+
+  // builder interface, used by BlockIdentifier
+  void addBlock(uint hid, const BlockInfo& block);
+  void mapLegacyPalette(const PaletteEntry* palette, int length);
+  // to be called after all blocks are added, slot 0 is the unknown biome
+  void addBiomes(const BiomeInfo& unknownBiome, const QList<const BiomeInfo*>& biomes);
+
+  quint16 getDenseId(uint hid) const
+  {
+    return m_denseIds.value(hid, 0);
+  }
+
+  // dense id of an entry of the FlatteningConverter palette used by pre-flattening chunks
+  quint16 getLegacyDenseId(int paletteIndex) const
+  {
+    return (paletteIndex < m_legacyDenseIds.size()) ? m_legacyDenseIds[paletteIndex] : 0;
+  }
+
+  const Entry& get(quint16 denseId) const
+  {
+    return m_entries[denseId];
+  }
+
+  int size() const
+  {
+    return m_entries.size();
+  }
+
+  int getBiomeSlot(int biomeId) const
+  {
+    return (biomeId >= 0 && biomeId < m_biomeSlots.size()) ? m_biomeSlots[biomeId] : 0;
+  }
+
+  // color of a tinted block (entry.tint >= 0) in a biome at height y
+  QRgb getTintedColor(const Entry& entry, int biomeSlot, int y, int light) const
+  {
+    const int band = qBound(0, y, 255) / ElevationBandHeight;
+    return m_tintColors[((entry.tint * m_biomeSlotCount + biomeSlot) * ElevationBands + band) * LightLevels
+                        + (light - MinLight)];
+  }
+
+  // pow(0.90, 15 - light) for light in MinLight..MaxLight
+  static float getLightFactor(int light);
+
+private:
+  QVector<Entry> m_entries;
+  QHash<uint, quint16> m_denseIds;
+  QHash<const BlockInfo*, quint16> m_blockIds;  // blocks can be registered with more than one hid
+  QVector<quint16> m_legacyDenseIds;
+  QVector<quint16> m_biomeSlots;  // biome id -> slot
+  int m_biomeSlotCount;
+  QVector<QRgb> m_tintColors;     // [tint][biome slot][elevation band][light]
+
+  static Entry createEntry(const BlockInfo& block);
+};
+
+typedef QSharedPointer<const BlockRenderTable> BlockRenderTablePtr;
+
+// Resolves the blocks of one chunk to table entries, the palettes of the sections are mapped on first use.
+class BlockRenderLookup
+{
+public:
+  explicit BlockRenderLookup(const BlockRenderTable& table)
+    : m_table(table)
+  {}
+
+  quint16 getId(const ChunkSection& section, int sectionIndex, int offset, int y);
+
+  const BlockRenderTable::Entry& get(const ChunkSection& section, int sectionIndex, int offset, int y)
+  {
+    return m_table.get(getId(section, sectionIndex, offset, y));
+  }
+
+private:
+  const BlockRenderTable& m_table;
+  std::array<std::vector<qint32>, 16> m_sectionIds;
+};
+
+#endif  // BLOCKRENDERTABLE_H
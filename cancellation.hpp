@@ -122,6 +122,12 @@ public:
   {}
 
   ~AsyncExecutionCancelGuard()
+  {
+    cancelAndWait();
+  }
+
+  // to be called by the owner, when async jobs still access other members during destruction
+  void cancelAndWait()
   {
     cancellation.cancelAndWait();
   }
@@ -34,11 +34,23 @@ quint16 getBits(const unsigned char *data, int pos, int n) {
 
 
 Chunk::Chunk()
-  : entities(QSharedPointer<EntityMap>::create())
+  : layerIndex(QSharedPointer<ColumnLayerIndex>::create())
+  , entities(QSharedPointer<EntityMap>::create())
 {
   loaded = false;
 }
 
+QSharedPointer<const ColumnLayerIndex> Chunk::getLayerIndex(const QSharedPointer<const BlockRenderTable>& table)
+{
+  QMutexLocker locker(&layerIndexMutex);
+  if (!layerIndex->isBuiltWith(table)) {
+    QSharedPointer<ColumnLayerIndex> index = QSharedPointer<ColumnLayerIndex>::create();
+    index->build(sections, table);
+    layerIndex = index;
+  }
+  return layerIndex;
+}
+
 Chunk::~Chunk() {
   if (loaded) {
     for (int i = 0; i < 16; i++)
@@ -131,6 +143,9 @@ void Chunk::load(const NBT &nbt) {
   }
   }
 
+  // render table attributes of all columns, used to skip invisible blocks during rendering
+  getLayerIndex(BlockIdentifier::Instance().getRenderTable());
+
   // check for the highest block in this chunk
   // todo: use highmap from stored NBT data
   for (int i = 15; i >= 0; i--) {
@@ -247,6 +262,7 @@ void Chunk::loadSection1519(ChunkSection *cs, const Tag *section) {
     }
   } else {
     // create a dummy palette
+    cs->paletteLength = 1;
     cs->palette = new PaletteEntry[1];
     cs->palette[0].name = "minecraft:air";
     cs->palette[0].hid  = 0;
@@ -10,9 +10,11 @@
 #include <QImage>
 
 #include "./paletteentry.h"
+#include "./columnlayerindex.h"
 #include "./generatedstructure.h"
 
 class BlockIdentifier;
+class BlockRenderTable;
 class ChunkRenderer;
 class DrawHelper2;
 
@@ -43,6 +45,7 @@ struct Block
 };
 
 class RenderedChunk;
+class ChunkGBuffer;
 
 class Chunk : public QObject {
   Q_OBJECT
@@ -61,6 +64,10 @@ class Chunk : public QObject {
   int getChunkX() const { return chunkX; }
   int getChunkZ() const { return chunkZ; }
 
+  // layer index for the render table, built again when the table was replaced since
+  // (definitions or biomes changed, see BlockIdentifier::invalidateRenderTable())
+  QSharedPointer<const ColumnLayerIndex> getLayerIndex(const QSharedPointer<const BlockRenderTable>& table);
+
  protected:
   void loadSection1343(ChunkSection *cs, const Tag *section);
   void loadSection1519(ChunkSection *cs, const Tag *section);
@@ -68,6 +75,8 @@ class Chunk : public QObject {
   quint32 biomes[16*16];
   int highest;
   ChunkSection *sections[16];
+  QSharedPointer<const ColumnLayerIndex> layerIndex;
+  QMutex layerIndexMutex;  // render jobs of the same chunk may build it concurrently
   bool loaded;
   QSharedPointer<EntityMap> entities;
   int chunkX;
@@ -87,19 +96,49 @@ struct RenderParams
   RenderParams()
     : renderedAt(-1)
     , renderedFlags(0)
+    , minDepth(-1)
+    , maxDepth(-1)
+    , dependsOnFlags(~0)
+    , lod(1)
+  {}
+
+  RenderParams(int depth, int flags, int lod_ = 1)
+    : renderedAt(depth)
+    , renderedFlags(flags)
+    , minDepth(depth)
+    , maxDepth(depth)
+    , dependsOnFlags(~0)
+    , lod(lod_)
   {}
 
   int renderedAt;
   int renderedFlags;
 
+  // what the rendering actually depended on: the result is the same for every depth in
+  // minDepth..maxDepth and for changes of flags not in dependsOnFlags
+  int minDepth;
+  int maxDepth;
+  int dependsOnFlags;
+
+  int lod;  // level of detail of the image, see RenderSettings::lod
+
   void invalidate()
   {
     renderedAt = -1;
   }
 
+  // true when rendering with the other parameters gives the same result
+  bool isValidFor(const RenderParams& other) const
+  {
+    return (renderedAt >= 0) &&
+           (other.renderedAt >= minDepth) && (other.renderedAt <= maxDepth) &&
+           (((renderedFlags ^ other.renderedFlags) & dependsOnFlags) == 0) &&
+           (lod == other.lod);
+  }
+
   bool operator==(const RenderParams& other) const
   {
-    return (renderedAt == other.renderedAt) && (renderedFlags == other.renderedFlags);
+    return (renderedAt == other.renderedAt) && (renderedFlags == other.renderedFlags) && (lod == other.lod);
   }
 
   bool operator!=(const RenderParams& other) const
@@ -108,6 +147,17 @@ struct RenderParams
   }
 };
 
+// heights of the border column of a rendered chunk, north->south, -1 where not known
+// the relief shading of a chunk continues the heights of its west neighbor
+typedef std::array<qint16, 16> ChunkEdgeHeights;
+
+inline ChunkEdgeHeights unknownEdgeHeights()
+{
+  ChunkEdgeHeights edge;
+  edge.fill(-1);
+  return edge;
+}
+
 class RenderedChunk
 {
 public:
@@ -120,21 +170,35 @@ public:
   QImage depth;
   QImage image;
 
+  // scan result, kept to shade the chunk again without scanning the blocks
+  QSharedPointer<const ChunkGBuffer> gbuffer;
+
+  ChunkEdgeHeights westEdge;  // east edge of the west neighbor, used for shading
+  ChunkEdgeHeights eastEdge;  // result, continued by the east neighbor
+
   RenderedChunk(const QSharedPointer<Chunk>& chunk)
     : entities(chunk->getEntityMapSp())
     , chunkX(chunk->getChunkX())
     , chunkZ(chunk->getChunkZ())
     , renderedFor()
+    , westEdge(unknownEdgeHeights())
+    , eastEdge(unknownEdgeHeights())
   {
   }
 
-  void init();
-
-  void freeImageData()
+  RenderedChunk(int chunkX_, int chunkZ_, const QSharedPointer<Chunk::EntityMap>& entities_,
+                const QSharedPointer<const ChunkGBuffer>& gbuffer_)
+    : entities(entities_)
+    , chunkX(chunkX_)
+    , chunkZ(chunkZ_)
+    , renderedFor()
+    , gbuffer(gbuffer_)
+    , westEdge(unknownEdgeHeights())
+    , eastEdge(unknownEdgeHeights())
   {
-    depth = QImage();
-    image = QImage();
   }
+
+  void init();
 };
 
 #endif  // CHUNK_H_
@@ -19,7 +19,7 @@ ChunkCache::ChunkCache(const QSharedPointer<PriorityThreadPool>& threadPool)
     , m_loaderPool(threadPool)
 
 {
-  chunkStates.reserve(256*1024*1024);
+  chunkStates.reserve(1024*1024);  // grows on demand
 
   int chunks = 10000;  // 10% more than 1920x1200 blocks
 #if defined(__unix__) || defined(__unix) || defined(unix)
@@ -52,6 +52,8 @@ ChunkCache::ChunkCache(const QSharedPointer<PriorityThreadPool>& threadPool)
 
   connect(&m_loaderPool, SIGNAL(chunkUpdated(QSharedPointer<Chunk>, ChunkID)),
           this, SLOT(gotChunk(const QSharedPointer<Chunk>&, ChunkID)));
+  connect(&m_loaderPool, SIGNAL(chunkLoadingDropped(ChunkID)),
+          this, SLOT(loadingDropped(ChunkID)));
 }
 
 ChunkCache::~ChunkCache() {
@@ -60,6 +62,7 @@ ChunkCache::~ChunkCache() {
 
 void ChunkCache::clear() {
   QThreadPool::globalInstance()->waitForDone();
+  m_loaderPool.cancelPending();  // don't wait, results of running jobs are dropped
   mutex.lock();
   cache.clear();
   chunkStates.clear();
@@ -83,7 +86,7 @@ int ChunkCache::getMaxCost() const {
   return cache.maxCost();
 }
 
-QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(ChunkID id)
+QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(ChunkID id, ChunkReadMode mode)
 {
   {
     QMutexLocker locker(&mutex);
@@ -98,7 +101,7 @@ QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(ChunkID id)
     chunkState << ChunkState::Loading;
   }
 
-  ChunkLoader loader(path, id);
+  ChunkLoader loader(path, id, mode);
   auto chunk = loader.runInternal();
 
   gotChunk(chunk, id);
@@ -106,6 +109,17 @@ QSharedPointer<Chunk> ChunkCache::getChunkSynchronously(ChunkID id)
   return chunk;
 }
 
+void ChunkCache::setLoadPriorityProvider(const ChunkPriorityProviderT& provider)
+{
+  QMutexLocker locker(&mutex);
+  m_loadPriority = provider;
+}
+
+QVector<PipelineStageStats> ChunkCache::getPipelineStats()
+{
+  return m_loaderPool.getStageStats();
+}
+
 bool ChunkCache::fetch_unprotected(QSharedPointer<Chunk>& chunk_out, ChunkID id, FetchBehaviour behav)
 {
   const bool cached = isCached_unprotected(id, &chunk_out);
@@ -186,6 +200,15 @@ void ChunkCache::gotChunk(const QSharedPointer<Chunk>& chunk, ChunkID id)
   //std::cout << "cached chunks: " << cachemap.size() << std::endl;
 }
 
+void ChunkCache::loadingDropped(ChunkID id)
+{
+  QMutexLocker locker(&mutex);
+
+  chunkStates[id].unset(ChunkState::Loading);
+
+  emit chunkLoadingDropped(id.getX(), id.getZ());
+}
+
 void ChunkCache::loadChunkAsync_unprotected(ChunkID id)
 {
     {
@@ -199,7 +222,7 @@ void ChunkCache::loadChunkAsync_unprotected(ChunkID id)
       chunkState << ChunkState::Loading;
     }
 
-  m_loaderPool.enqueueChunkLoading(path, id);
+  m_loaderPool.enqueueChunkLoading(path, id, m_loadPriority);
 }
 
 void ChunkCache::adaptCacheToWindow(int wx, int wy) {
@@ -67,10 +67,16 @@ private:
       QMutexLocker m_locker;
   };
 
-  QSharedPointer<Chunk> getChunkSynchronously(ChunkID id);
+  QSharedPointer<Chunk> getChunkSynchronously(ChunkID id, ChunkReadMode mode = ChunkReadMode::interactive);
+
+  // used to prioritize and drop asynchronous loading jobs, called from worker threads
+  void setLoadPriorityProvider(const ChunkPriorityProviderT& provider);
+
+  QVector<PipelineStageStats> getPipelineStats();
 
  signals:
   void chunkLoaded(const QSharedPointer<Chunk>& chunk, int x, int z);
+  void chunkLoadingDropped(int x, int z);
   void structureFound(QSharedPointer<GeneratedStructure> structure);
 
  public slots:
@@ -79,6 +85,7 @@ private:
  private slots:
   void routeStructure(QSharedPointer<GeneratedStructure> structure);
   void gotChunk(const QSharedPointer<Chunk>& chunk, ChunkID id);
+  void loadingDropped(ChunkID id);
 
  private:
   QString path;                                   // path to folder with region files
@@ -97,6 +104,7 @@ private:
   QThreadPool loaderThreadPool;                   // extra thread pool for loading
 
   ChunkLoaderThreadPool m_loaderPool;
+  ChunkPriorityProviderT m_loadPriority;
 
   void loadChunkAsync_unprotected(ChunkID id);
 
@@ -0,0 +1,90 @@
+#ifndef CHUNKGBUFFER_H
+#define CHUNKGBUFFER_H
+
+#include "./blockrendertable.h"
+
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+// Output of the scan stage of the chunk renderer: the blocks that contribute to each pixel of one chunk.
+//
+// The shade stage turns it into the image with the current lighting, depth shading, cave mode and biome color
+// settings, so toggling one of them doesn't scan the blocks again. A G-buffer stays valid for the range of
+// depths and scan flags (ChunkRenderer::getScanFlags()) that select the same blocks. Scanned with a level of
+// detail > 1 it only contains every lod-th column, which also serves the coarser levels.
+class ChunkGBuffer
+{
+public:
+  enum SpawnFlags : quint8
+  {
+    SpawnOnTop  = 0x01,  // a mob can spawn on top of the block
+    SpawnInside = 0x02,  // a mob can spawn inside of the block (e.g. snow)
+  };
+
+  // one block of the blend stack of a pixel
+  struct Sample
+  {
+    quint16 block;  // dense id in the render table
+    quint8 y;
+    quint8 light;   // block light of the block above
+    quint8 spawn;   // SpawnFlags, only scanned with MapView::flgMobSpawn
+  };
+
+  struct Pixel
+  {
+    quint32 biome;
+    quint16 caveMask;      // bit i: block i+1 below the top sample counts as open space in cave mode
+    quint16 baseCaveMask;  // same below the base block
+    quint8 baseY;          // first nearly opaque block, the only one shown with biome colors
+    quint8 baseLight;
+  };
+
+  ChunkGBuffer(const BlockRenderTablePtr& table_, int depth_, int scanFlags_, int lod_)
+    : table(table_)
+    , depth(depth_)
+    , scanFlags(scanFlags_)
+    , lod(lod_)
+    , minDepth(depth_)
+    , maxDepth(depth_)
+    , dependsOnFlags(~0)
+  {}
+
+  bool hasColumnsFor(int lod_) const
+  {
+    return (lod_ % lod) == 0;
+  }
+
+  bool isValidFor(int depth_, int scanFlags_, int lod_) const
+  {
+    return (depth_ >= minDepth) && (depth_ <= maxDepth) && (((scanFlags ^ scanFlags_) & dependsOnFlags) == 0) &&
+           hasColumnsFor(lod_);
+  }
+
+  // blend stack of one pixel ordered top->down, empty when nothing is visible or the column wasn't scanned
+  const Sample* begin(int offset) const
+  {
+    return samples.data() + sampleStart[offset];
+  }
+  const Sample* end(int offset) const
+  {
+    return samples.data() + sampleStart[offset + 1];
+  }
+
+  const BlockRenderTablePtr table;  // the dense ids belong to this snapshot
+  const int depth;  // scanned with
+  const int scanFlags;
+  const int lod;  // every lod-th column is scanned
+
+  // the same blocks are selected for these depths and changes of scan flags not in dependsOnFlags
+  int minDepth;
+  int maxDepth;
+  int dependsOnFlags;
+
+  std::array<Pixel, 16*16> pixels;
+  std::vector<Sample> samples;
+  std::array<quint32, 16*16 + 1> sampleStart;
+};
+
+#endif  // CHUNKGBUFFER_H
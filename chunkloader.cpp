@@ -4,12 +4,16 @@
 #include "./chunkcache.h"
 #include "./chunk.h"
 #include "./prioritythreadpool.h"
+#include "./nbt.h"
+#include "./regionfilereader.h"
+#include "./resourcegovernor.h"
 
-#include <future>
+#include <algorithm>
 
-ChunkLoader::ChunkLoader(QString path, ChunkID id_)
+ChunkLoader::ChunkLoader(QString path, ChunkID id_, ChunkReadMode mode)
   : path(path)
   , id(id_)
+  , mode(mode)
 {}
 
 ChunkLoader::~ChunkLoader()
@@ -26,39 +30,30 @@ void ChunkLoader::run() {
     //emit chunkUpdated(newChunk, id);
 }
 
-QSharedPointer<NBT> ChunkLoader::loadNbt()
+QByteArray ChunkLoader::readCompressed()
 {
-    QString filename = getRegionFilename(path, id);
+  const RegionReadMode readMode = (mode == ChunkReadMode::background)
+      ? ResourceGovernor::Instance().getScanReadMode()
+      : RegionReadMode::cached;
 
-    QFile f(filename);
-  if (!f.open(QIODevice::ReadOnly)) {  // no chunks in this region
-      return QSharedPointer<NBT>();
-  }
-  // map header into memory
-  uchar *header = f.map(0, 4096);
-  int offset = 4 * ((id.getX() & 31) + (id.getZ() & 31) * 32);
-  int coffset = (header[offset] << 16) | (header[offset + 1] << 8) |
-      header[offset + 2];
-  int numSectors = header[offset+3];
-  f.unmap(header);
-
-  if (coffset == 0) {  // no chunk
-    f.close();
-    return QSharedPointer<NBT>();
-  }
+  RegionFileReader region(getRegionFilename(path, id), readMode);
+  QByteArray raw = region.readChunk(id.getX() & 31, id.getZ() & 31);
 
-  uchar *raw = f.map(coffset * 4096, numSectors * 4096);
-    if (raw == nullptr) {
-    f.close();
-    return QSharedPointer<NBT>();
+  if (mode == ChunkReadMode::background) {
+    ResourceGovernor::Instance().throttleBackgroundIo(raw.size());
   }
 
-  auto nbt = QSharedPointer<NBT>::create(raw);
+  return raw;
+}
 
-  f.unmap(raw);
-  f.close();
+QSharedPointer<NBT> ChunkLoader::loadNbt()
+{
+  const QByteArray raw = readCompressed();
+  if (raw.isEmpty()) {
+    return QSharedPointer<NBT>();
+  }
 
-  return nbt;
+  return NBT::fromInflated(NBT::inflateChunk(reinterpret_cast<const uchar*>(raw.constData())));
 }
 
 QSharedPointer<Chunk> ChunkLoader::runInternal()
@@ -88,28 +83,80 @@ QString ChunkLoader::getRegionFilename(const QString& path, const ChunkID& id)
 ChunkLoaderThreadPool::ChunkLoaderThreadPool(const QSharedPointer<PriorityThreadPool> &threadPool_)
   : asyncGuard()
   , threadPool(threadPool_)
+  , ioStage("io", threadPool, PriorityThreadPool::JobPrio::low, JobClass::load, asyncGuard, [this](LoadItem& item) {
+      ChunkLoader loader(item.path, item.id);
+      item.data = loader.readCompressed();
+      if (item.data.isEmpty())
+      {
+        emit chunkUpdated(QSharedPointer<Chunk>(), item.id);
+        return false;
+      }
+      return true;
+    })
+  , decompressStage("decompress", threadPool, PriorityThreadPool::JobPrio::low, JobClass::load, asyncGuard, [](LoadItem& item) {
+      item.data = NBT::inflateChunk(reinterpret_cast<const uchar*>(item.data.constData()));
+      return true;
+    })
+  , decodeStage("decode", threadPool, PriorityThreadPool::JobPrio::low, JobClass::load, asyncGuard, [this](LoadItem& item) {
+      auto nbt = NBT::fromInflated(item.data);
+      item.data.clear();
+
+      auto chunk = QSharedPointer<Chunk>::create();
+      chunk->load(*nbt);
+      emit chunkUpdated(chunk, item.id);
+      return false;
+    })
 {
+  const size_t cores = threadPool->getNumberOfThreads();
+
+  // the I/O stage only queues chunk IDs -> unbounded, all later stages hold chunk data
+  ioStage.configure(0, std::max<size_t>(cores / 2, 1));
+  decompressStage.configure(2 * cores, cores);
+  decodeStage.configure(2 * cores, cores);
+
+  const auto priority = [](const LoadItem& item) {
+    return item.priority ? item.priority(item.id) : 0.0;
+  };
+  const auto onDropped = [this](LoadItem& item) {
+    emit chunkLoadingDropped(item.id);
+  };
+
+  for (auto stage: {&ioStage, &decompressStage, &decodeStage})
+  {
+    stage->setPriority(priority, onDropped);
+  }
 
+  ioStage.connectTo(decompressStage);
+  decompressStage.connectTo(decodeStage);
 }
 
 ChunkLoaderThreadPool::~ChunkLoaderThreadPool()
 {
-
+  asyncGuard.cancelAndWait();  // jobs of one stage access the neighbor stages
 }
 
-void ChunkLoaderThreadPool::enqueueChunkLoading(QString path, ChunkID id)
+void ChunkLoaderThreadPool::enqueueChunkLoading(QString path, ChunkID id, const ChunkPriorityProviderT& priority)
 {
-    threadPool->enqueueJob([this, path, id, cancelToken = asyncGuard.getToken()](){
+  LoadItem item;
+  item.path = path;
+  item.id = id;
+  item.priority = priority;
+  ioStage.push(std::move(item));
+}
 
-      if (cancelToken.isCanceled())
-      {
-        return;
-      }
+void ChunkLoaderThreadPool::cancelPending()
+{
+  ioStage.clear();
+  decompressStage.clear();
+  decodeStage.clear();
+}
 
-      ChunkLoader loader(path, id);
-      auto chunk = loader.runInternal();
-      emit chunkUpdated(chunk, id);
-    });
+QVector<PipelineStageStats> ChunkLoaderThreadPool::getStageStats()
+{
+  return QVector<PipelineStageStats>()
+      << ioStage.getStats()
+      << decompressStage.getStats()
+      << decodeStage.getStats();
 }
 
 void ChunkLoaderThreadPool::signalUpdated(QSharedPointer<Chunk> chunk, ChunkID id)
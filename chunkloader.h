@@ -4,9 +4,13 @@
 
 #include "coordinateid.h"
 #include "cancellation.hpp"
+#include "pipelinestage.hpp"
 
 #include <QObject>
 #include <QRunnable>
+#include <QVector>
+
+#include <functional>
 
 class Chunk;
 class ChunkID;
@@ -14,6 +18,17 @@ class QMutex;
 class NBT;
 class PriorityThreadPool;
 
+// priority of loading a chunk, see PriorityThreadPool::PriorityEvaluatorT
+typedef std::function<double(const ChunkID&)> ChunkPriorityProviderT;
+
+// interactive reads serve the viewport, background reads serve bulk scans (search, export)
+// and are subject to the I/O limit of the ResourceGovernor
+enum class ChunkReadMode
+{
+  interactive,
+  background
+};
+
 class ChunkLoaderThreadPool : public QObject
 {
   Q_OBJECT
@@ -22,26 +37,47 @@ public:
   ChunkLoaderThreadPool(const QSharedPointer<PriorityThreadPool>& threadPool);
   ~ChunkLoaderThreadPool();
 
-  void enqueueChunkLoading(QString path, ChunkID id);
+  void enqueueChunkLoading(QString path, ChunkID id, const ChunkPriorityProviderT& priority = ChunkPriorityProviderT());
+
+  QVector<PipelineStageStats> getStageStats();
+
+  // drops all loading requests that are not finished yet (e.g. world switch)
+  void cancelPending();
 
 signals:
   void chunkUpdated(QSharedPointer<Chunk> chunk, ChunkID id);
+  void chunkLoadingDropped(ChunkID id);
 
 private:
+  struct LoadItem
+  {
+    QString path;
+    ChunkID id;
+    ChunkPriorityProviderT priority;
+    QByteArray data;  // compressed after I/O stage, inflated after decompress stage
+  };
+
   AsyncExecutionCancelGuard asyncGuard;
   QSharedPointer<PriorityThreadPool> threadPool;
 
+  // loading pipeline: read from region file -> inflate -> parse NBT and Chunk::load()
+  PipelineStage<LoadItem> ioStage;
+  PipelineStage<LoadItem> decompressStage;
+  PipelineStage<LoadItem> decodeStage;
+
   void signalUpdated(QSharedPointer<Chunk> chunk, ChunkID id);
 };
 
 class ChunkLoader
 {
  public:
-  ChunkLoader(QString path, ChunkID id_);
+  ChunkLoader(QString path, ChunkID id_, ChunkReadMode mode = ChunkReadMode::interactive);
   ~ChunkLoader();
 
   void run();
 
+  QByteArray readCompressed();
+
   QSharedPointer<NBT> loadNbt();
 
   QSharedPointer<Chunk> runInternal();
@@ -51,6 +87,7 @@ class ChunkLoader
  private:
   QString path;
   ChunkID id;
+  ChunkReadMode mode;
 };
 
 #endif  // CHUNKLOADER_H_
@@ -3,245 +3,738 @@
 #include "./chunk.h"
 #include "./chunkrenderer.h"
 #include "./chunkcache.h"
-#include "./mapview.h"
+#include "./mapviewrenderer.h"
 #include "./blockidentifier.h"
+#include "./blockrendertable.h"
+#include "./chunkgbuffer.h"
 #include "./biomeidentifier.h"
 #include "./clamp.h"
 
+#include <algorithm>
+#include <array>
+#include <utility>
 
 
-ChunkRenderer::ChunkRenderer(const QSharedPointer<Chunk> &chunk, MapView &parent_)
-    : m_chunk(chunk)
-    , m_parent(parent_)
-{}
+namespace {
 
-ChunkRenderer::~ChunkRenderer()
-{}
+typedef ColumnLayerIndex::Layer Layer;
+typedef ChunkGBuffer::Sample Sample;
 
-void ChunkRenderer::run()
+// flags that select the scanned blocks, all other flags that change the image are applied when shading
+const int ScanFlagMask = RenderSettings::MobSpawn | RenderSettings::SingleLayer | RenderSettings::SeaGround;
+const int ScanFlagCount = 3;
+const int ShadeFlagCount = 4;
+
+constexpr int scanFlagsFromIndex(int index)
 {
+  return ((index & 0x01) << 1) | ((index & 0x02) << 4) | ((index & 0x04) << 5);
 }
 
-void ChunkRenderer::renderChunk(MapView &parent, const QSharedPointer<Chunk>& chunk, RenderedChunk &rendered_out)
+int scanIndexFromFlags(int flags)
 {
-  if (!chunk)
-  {
-    return;
-  }
+  return ((flags >> 1) & 0x01) | ((flags >> 4) & 0x02) | ((flags >> 5) & 0x04);
+}
 
-  int depth;
-  int flags;
+constexpr int shadeFlagsFromIndex(int index)
+{
+  // RenderSettings::Lighting, CaveMode, DepthShading, BiomeColors
+  return (index & 0x01) | ((index & 0x06) << 1) | ((index & 0x08) << 3);
+}
 
-  {
-    QReadLocker locker(&parent.m_readWriteLock);
+int shadeIndexFromFlags(int flags)
+{
+  return (flags & 0x01) | ((flags >> 1) & 0x06) | ((flags >> 3) & 0x08);
+}
 
-    depth = parent.depth;
-    flags = parent.flags;
-  }
+template <int Flags>
+inline bool isVisible(const Layer &layer)
+{
+  if (Flags & RenderSettings::SeaGround)
+    return (layer.flags & (ColumnLayerIndex::Visible | ColumnLayerIndex::Liquid)) == ColumnLayerIndex::Visible;
+  return layer.flags & ColumnLayerIndex::Visible;
+}
 
-  RenderedChunk& renderData = rendered_out;
+inline bool isVisibleLiquid(const Layer &layer)
+{
+  return (layer.flags & (ColumnLayerIndex::Visible | ColumnLayerIndex::Liquid))
+         == (ColumnLayerIndex::Visible | ColumnLayerIndex::Liquid);
+}
 
-  if (renderData.image.isNull() || renderData.depth.isNull())
-  {
-    return;
+// moves forward to the layer containing y, y must be below the current layer's top
+inline const Layer *advance(const Layer *layer, const Layer *layersEnd, int y)
+{
+  while (layer + 1 != layersEnd && (layer + 1)->top >= y)
+    ++layer;
+  return layer;
+}
+
+// open space in cave mode below a block, bit i is the block i+1 below
+quint16 getCaveMask(const ColumnLayerIndex &layerIndex, int offset, int highest)
+{
+  quint16 mask = 0;
+  if (highest == 0)
+    return mask;
+  const Layer *layersEnd = layerIndex.end(offset);
+  for (const Layer *layer = layerIndex.find(offset, highest-1); layer != layersEnd; ++layer) {  // top->down
+    // the blocks of a layer are all open or not, set them at once
+    const int first = highest-1 - std::min<int>(layer->top, highest-1);
+    if (first >= CaveShade::CAVE_DEPTH)
+      break;
+    const int bottom = (layer + 1 == layersEnd) ? 0 : (layer + 1)->top + 1;
+    const int last = std::min(highest-1 - bottom, CaveShade::CAVE_DEPTH - 1);
+    if (layer->flags & ColumnLayerIndex::Transparent)
+      mask |= ((2 << last) - 1) & ~((1 << first) - 1);
   }
+  return mask;
+}
 
-  int offset = 0;
-  uchar *bits = renderData.image.bits();
-  uchar *depthbits = renderData.depth.bits();
-  for (int z = 0; z < 16; z++) {  // n->s
-    int lasty = -1;
-    for (int x = 0; x < 16; x++, offset++) {  // e->w
-      // initialize color
-      uchar r = 0, g = 0, b = 0;
-      double alpha = 0.0;
-      // get Biome
-      const auto &biome = BiomeIdentifier::Instance().getBiome(chunk->biomes[offset]);
-      int top = depth;
-      if (top > chunk->highest)
-        top = chunk->highest;
-      if (flags & MapView::flgSingleLayer)
-        top = depth;
-      int highest = 0;
-      for (int y = top; y >= 0; y--) {  // top->down
-        // perform a one deep scan in SingleLayer mode
-        if ((flags & MapView::flgSingleLayer) && (y < top))
+int getLightAbove(const Chunk &chunk, int offset, int y)
+{
+  ChunkSection *section = NULL;
+  if (y < 255)
+    section = chunk.sections[(y+1) >> 4];
+  return section ? section->getBlockLight(offset, y+1) : 0;
+}
+
+// Scan stage: collects the blocks contributing to each pixel with the scan flags as compile time constant.
+// With a level of detail > 1 only every lod-th column in both directions is scanned.
+template <int Flags>
+QSharedPointer<const ChunkGBuffer> scanKernel(const Chunk &chunk, const ColumnLayerIndex &layerIndex,
+                                              const BlockRenderTablePtr &tablePtr, int depth, int lod)
+{
+  static const qint32 Saturated = BlockRenderTable::FixedOne * 9 / 10;  // alpha > 0.9
+  const BlockRenderTable &table = *tablePtr;
+  BlockRenderLookup lookup(table);
+  const BlockRenderTable::Entry &air = table.get(table.getDenseId(0));
+
+  QSharedPointer<ChunkGBuffer> gbuffer = QSharedPointer<ChunkGBuffer>::create(tablePtr, depth, Flags, lod);
+  std::vector<Sample> &samples = gbuffer->samples;
+  samples.reserve(16*16*2 / (lod * lod));
+  const int lodMask = lod - 1;
+
+  // narrowed down to the depths that select the same blocks in every column
+  int minDepth = (Flags & RenderSettings::SingleLayer) ? depth : 0;
+  int maxDepth = (Flags & RenderSettings::SingleLayer) ? depth : 255;
+  bool sawLiquid = false;  // visible liquid in the scanned range
+  bool sawSpawn = false;
+
+  for (int offset = 0; offset < 16*16; offset++) {
+    gbuffer->sampleStart[offset] = static_cast<quint32>(samples.size());
+    if (((offset | (offset >> 4)) & lodMask) != 0)
+      continue;  // not shaded at this level of detail
+    ChunkGBuffer::Pixel &pixel = gbuffer->pixels[offset];
+    pixel.biome = chunk.biomes[offset];
+
+    qint32 alpha = 0;      // fixed-point, as blended by the shade stage
+    bool stacking = true;  // cleared when the blend stack is saturated, only the base block is searched then
+    int baseY = -1;        // the last visible block until a dense one is found
+
+    int top = depth;
+    if (top > chunk.highest)
+      top = chunk.highest;
+    if (Flags & RenderSettings::SingleLayer)
+      top = depth;
+    const Layer *layer = layerIndex.find(offset, top);
+    const Layer *layersEnd = layerIndex.end(offset);
+    for (int y = top; y >= 0; y--) {  // top->down
+      // perform a one deep scan in SingleLayer mode
+      if ((Flags & RenderSettings::SingleLayer) && (y < top))
+        break;
+      // skip invisible layers (air, missing sections) at once
+      layer = advance(layer, layersEnd, y);
+      sawLiquid |= isVisibleLiquid(*layer);
+      if (!isVisible<Flags>(*layer)) {
+        if (layer + 1 == layersEnd)
+          break;
+        y = (layer + 1)->top + 1;
+        continue;
+      }
+      if (!stacking) {
+        if (layer->flags & ColumnLayerIndex::Dense) {
+          baseY = y;
           break;
-        int sec = y >> 4;
-        ChunkSection *section = chunk->sections[sec];
-        if (!section) {
-          y = (sec << 4) - 1;  // skip whole section
-          continue;
         }
+        // nothing dense in this layer, its lowest block is the base unless a dense one follows
+        baseY = (layer + 1 == layersEnd) ? 0 : (layer + 1)->top + 1;
+        y = baseY;
+        continue;
+      }
+      int sec = y >> 4;
+      ChunkSection *section = chunk.sections[sec];
+      if (!section) continue;
 
-        // get data value
-        //int data = section->getData(offset, y);
+      const quint16 id = lookup.getId(*section, sec, offset, y);
+      const BlockRenderTable::Entry &block = table.get(id);
+      if (block.fixedAlpha == 0) continue;
 
-        // get BlockInfo from block value
-        const auto& paletteEntry = section->getPaletteEntry(offset, y);
-        const BlockInfo &block = BlockIdentifier::Instance().getBlockInfo(paletteEntry.hid);
-        if (block.alpha == 0.0) continue;
+      if (Flags & RenderSettings::SeaGround && block.has(BlockRenderTable::Liquid)) continue;
 
-        if (flags & MapView::flgSeaGround && block.isLiquid()) continue;
+      Sample sample;
+      sample.block = id;
+      sample.y = static_cast<quint8>(y);
+      sample.light = static_cast<quint8>(getLightAbove(chunk, offset, y));
+      sample.spawn = 0;
 
-        // get light value from one block above
-        int light = 0;
+      if (Flags & RenderSettings::MobSpawn) {
+        // get block info from 1 and 2 above and 1 below
+        // default to air (todo: better handling of block above)
         ChunkSection *section1 = NULL;
+        ChunkSection *section2 = NULL;
+        ChunkSection *sectionB = NULL;
         if (y < 255)
-          section1 = chunk->sections[(y+1) >> 4];
-        if (section1)
-          light = section1->getBlockLight(offset, y+1);
-        int light1 = light;
-        if (!(flags & MapView::flgLighting))
-          light = 13;
-        if (alpha == 0.0 && lasty != -1) {
-          if (lasty < y)
-            light += 2;
-          else if (lasty > y)
-            light -= 2;
+          section1 = chunk.sections[(y+1) >> 4];
+        if (y < 254)
+          section2 = chunk.sections[(y+2) >> 4];
+        if (y > 0)
+          sectionB = chunk.sections[(y-1) >> 4];
+        const BlockRenderTable::Entry &block2 = section2 ? lookup.get(*section2, (y+2) >> 4, offset, y+2) : air;
+        const BlockRenderTable::Entry &block1 = section1 ? lookup.get(*section1, (y+1) >> 4, offset, y+1) : air;
+        const BlockRenderTable::Entry &block0 = block;
+        const BlockRenderTable::Entry &blockB = sectionB ? lookup.get(*sectionB, (y-1) >> 4, offset, y-1) : air;
+        int light0 = section->getBlockLight(offset, y);
+        int light1 = sample.light;
+
+        // a mob fits into a block that is no normal cube, allows spawning inside and is no liquid
+        auto canSpawnInside = [](const BlockRenderTable::Entry &e) {
+          return (e.flags & (BlockRenderTable::NormalCube | BlockRenderTable::SpawnInside | BlockRenderTable::Liquid))
+                 == BlockRenderTable::SpawnInside;
+        };
+        auto canSpawnOnTop = [](const BlockRenderTable::Entry &e) {
+          return (e.flags & (BlockRenderTable::SolidTop | BlockRenderTable::Bedrock)) == BlockRenderTable::SolidTop;
+        };
+        auto fitsHead = [](const BlockRenderTable::Entry &e) {
+          return (e.flags & (BlockRenderTable::NormalCube | BlockRenderTable::SpawnInside)) == BlockRenderTable::SpawnInside;
+        };
+
+        // spawn check #1: on top of solid block
+        if (canSpawnOnTop(block0) && light1 < 8 &&
+            canSpawnInside(block1) && fitsHead(block2))
+          sample.spawn |= ChunkGBuffer::SpawnOnTop;
+        // spawn check #2: current block is transparent,
+        // but mob can spawn through (e.g. snow)
+        if (canSpawnOnTop(blockB) && light0 < 8 &&
+            canSpawnInside(block0) && fitsHead(block1))
+          sample.spawn |= ChunkGBuffer::SpawnInside;
+        sawSpawn |= (sample.spawn != 0);
+      }
+      samples.push_back(sample);
+      baseY = y;
+
+      // same accumulation as the shade stage, the blend stack ends when the color is saturated enough
+      if (alpha == 0)
+        alpha = block.fixedAlpha;
+      else
+        alpha += (block.fixedAlpha * (BlockRenderTable::FixedOne - alpha)) >> 15;
+      if (block.fixedAlpha > Saturated)
+        break;
+      if (alpha > Saturated)
+        stacking = false;
+    } // top -> down
+
+    if (!(Flags & RenderSettings::SingleLayer)) {
+      // a lower depth selects the same blocks down to the first visible one,
+      // a higher one up to the next visible block above or at all when that one is above the chunk's highest block
+      int upper = 255;
+      const Layer *topLayer = layerIndex.find(offset, top);
+      if (isVisible<Flags>(*topLayer) && top < topLayer->top) {
+        upper = top;
+      } else {
+        for (const Layer *above = topLayer; above != layerIndex.begin(offset); ) {  // down->top
+          --above;
+          sawLiquid |= isVisibleLiquid(*above);
+          if (isVisible<Flags>(*above)) {
+            upper = (above + 1)->top;
+            break;
+          }
         }
-//        if (light < 0) light = 0;
-//        if (light > 15) light = 15;
+      }
+      if (upper >= chunk.highest)
+        upper = 255;
+      const int lower = (baseY >= 0) ? samples[gbuffer->sampleStart[offset]].y : 0;
+      minDepth = std::max(minDepth, lower);
+      maxDepth = std::min(maxDepth, upper);
+    }
 
-        // get current block color
-        QColor blockcolor = block.colors[15];  // get the color from Block definition
-        if (block.biomeWater()) {
-          blockcolor = biome.getBiomeWaterColor(blockcolor);
-        }
-        else if (block.biomeGrass()) {
-          blockcolor = biome.getBiomeGrassColor(blockcolor, y-64);
-        }
-        else if (block.biomeFoliage()) {
-          blockcolor = biome.getBiomeFoliageColor(blockcolor, y-64);
-        }
+    if (baseY >= 0) {
+      const int highest = samples[gbuffer->sampleStart[offset]].y;
+      pixel.caveMask = getCaveMask(layerIndex, offset, highest);
+      pixel.baseCaveMask = (baseY == highest) ? pixel.caveMask : getCaveMask(layerIndex, offset, baseY);
+      pixel.baseY = static_cast<quint8>(baseY);
+      pixel.baseLight = static_cast<quint8>(getLightAbove(chunk, offset, baseY));
+    } else {
+      pixel.caveMask = pixel.baseCaveMask = 0;
+      pixel.baseY = pixel.baseLight = 0;
+    }
+  }
+  gbuffer->sampleStart[16*16] = static_cast<quint32>(samples.size());
+  samples.shrink_to_fit();
+
+  gbuffer->minDepth = minDepth;
+  gbuffer->maxDepth = maxDepth;
+  gbuffer->dependsOnFlags = RenderSettings::SingleLayer;
+  if (sawLiquid)
+    gbuffer->dependsOnFlags |= RenderSettings::SeaGround;
+  // spawn markers are only scanned with the flag, without it they are unknown
+  if (sawSpawn || !(Flags & RenderSettings::MobSpawn))
+    gbuffer->dependsOnFlags |= RenderSettings::MobSpawn;
+
+  return gbuffer;
+}
+
+// shading flags and depths a shaded image depends on, in addition to the ones of its G-buffer
+struct ShadeDependencies
+{
+  int flags;
+  int minDepth;
+  int maxDepth;
+};
+
+// cave shading curve in fixed-point
+struct FixedCaveShade
+{
+  qint32 shade[CaveShade::CAVE_DEPTH];
+
+  FixedCaveShade()
+  {
+    for (int i = 0; i < CaveShade::CAVE_DEPTH; i++)
+      shade[i] = static_cast<qint32>(CaveShade::getShade(i) * BlockRenderTable::FixedOne);
+  }
+};
+
+// Shade stage: colors the G-buffer with the shading flags as compile time constant.
+// Colors are blended with alpha in 15 bit fixed-point, each blended layer can differ by 1 from floating point.
+// The relief shading of the first column continues westEdge, the heights of the west neighbor.
+// Writes (16/lod)x(16/lod) pixels, one for each column scanned at that level of detail.
+template <int Flags>
+ShadeDependencies shadeKernel(const ChunkGBuffer &gbuffer, int depth, int lod, const ChunkEdgeHeights &westEdge,
+                              uchar *bits, int bytesPerLine, uchar *depthbits, int depthBytesPerLine)
+{
+  static const qint32 One = BlockRenderTable::FixedOne;
+  const BlockRenderTable &table = *gbuffer.table;
+  ShadeDependencies dependencies = {0, 0, 255};
+
+  for (int z = 0, row = 0; z < 16; z += lod, row++, bits += bytesPerLine, depthbits += depthBytesPerLine) {  // n->s
+    uchar *pixelbits = bits;
+    int lasty = westEdge[row];
+    for (int x = 0, column = 0; x < 16; x += lod, column++) {  // e->w
+      const int offset = (z << 4) | x;
+      const ChunkGBuffer::Pixel &pixel = gbuffer.pixels[offset];
+      const Sample *sample = gbuffer.begin(offset);
+      const Sample *samplesEnd = gbuffer.end(offset);
+
+      // initialize color
+      uchar r = 0, g = 0, b = 0;
+      int highest = 0;
+      quint16 caveMask = 0;
 
-        // shade color based on light value
-        double light_factor = pow(0.90,15-light);
-        quint32 colr = std::clamp( int(light_factor*blockcolor.red()),   0, 255 );
-        quint32 colg = std::clamp( int(light_factor*blockcolor.green()), 0, 255 );
-        quint32 colb = std::clamp( int(light_factor*blockcolor.blue()),  0, 255 );
-
-        // process flags
-        if (flags & MapView::flgDepthShading) {
-          // Use a table to define depth-relative shade:
-          static const quint32 shadeTable[] = {
-            0, 12, 18, 22, 24, 26, 28, 29, 30, 31, 32};
-          size_t idx = qMin(static_cast<size_t>(depth - y),
-                            sizeof(shadeTable) / sizeof(*shadeTable) - 1);
-          quint32 shade = shadeTable[idx];
-          colr = colr - qMin(shade, colr);
-          colg = colg - qMin(shade, colg);
-          colb = colb - qMin(shade, colb);
+      if ((Flags & RenderSettings::BiomeColors) && (sample != samplesEnd)) {
+        // every block replaces the color of the ones above, so only the base block remains
+        int light = (Flags & RenderSettings::Lighting) ? pixel.baseLight : 13;
+        if (lasty != -1 && pixel.baseY == sample->y) {
+          if (lasty < pixel.baseY)
+            light += 2;
+          else if (lasty > pixel.baseY)
+            light -= 2;
         }
+        const QColor &biomecolor = BiomeIdentifier::Instance().getBiome(pixel.biome).colors[std::clamp(light, 0, 15)];
+        r = biomecolor.red();
+        g = biomecolor.green();
+        b = biomecolor.blue();
+        highest = pixel.baseY;
+        caveMask = pixel.baseCaveMask;
+        dependencies.flags |= RenderSettings::BiomeColors;
+        if (pixel.baseLight != 13)
+          dependencies.flags |= RenderSettings::Lighting;
+      } else if (sample != samplesEnd) {
+        const int biomeSlot = table.getBiomeSlot(pixel.biome);
+        qint32 alpha = 0;  // fixed-point, BlockRenderTable::FixedOne is opaque
+        highest = sample->y;
+        caveMask = pixel.caveMask;
+        dependencies.flags |= RenderSettings::BiomeColors | RenderSettings::DepthShading;
+        for (; sample != samplesEnd; ++sample) {  // top->down
+          const BlockRenderTable::Entry &block = table.get(sample->block);
+          const int y = sample->y;
+          if (sample->light != 13)
+            dependencies.flags |= RenderSettings::Lighting;
+
+          int light = (Flags & RenderSettings::Lighting) ? sample->light : 13;
+          if (alpha == 0 && lasty != -1) {
+            if (lasty < y)
+              light += 2;
+            else if (lasty > y)
+              light -= 2;
+          }
 
-        if (flags & MapView::flgMobSpawn) {
-          // get block info from 1 and 2 above and 1 below
-          uint blid1(0), blid2(0), blidB(0);  // default to legacy air (todo: better handling of block above)
-          ChunkSection *section2 = NULL;
-          ChunkSection *sectionB = NULL;
-          if (y < 254)
-            section2 = chunk->sections[(y+2) >> 4];
-          if (y > 0)
-            sectionB = chunk->sections[(y-1) >> 4];
-          if (section1) {
-            blid1 = section1->getPaletteEntry(offset, y+1).hid;
+          // get current block color, shaded based on light value and tinted by biome
+          QRgb color = (block.tint < 0) ? block.getColor(light)
+                                        : table.getTintedColor(block, biomeSlot, y, light);
+          quint32 colr = qRed(color);
+          quint32 colg = qGreen(color);
+          quint32 colb = qBlue(color);
+
+          // process flags
+          if (Flags & RenderSettings::DepthShading) {
+            // Use a table to define depth-relative shade:
+            static const quint32 shadeTable[] = {
+              0, 12, 18, 22, 24, 26, 28, 29, 30, 31, 32};
+            const int maxShadeIndex = sizeof(shadeTable) / sizeof(*shadeTable) - 1;
+            size_t idx = qMin(depth - y, maxShadeIndex);
+            // the shade of blocks deep enough below the depth doesn't change with it
+            if (depth - y < maxShadeIndex)
+              dependencies.minDepth = dependencies.maxDepth = depth;
+            else
+              dependencies.minDepth = std::max(dependencies.minDepth, y + maxShadeIndex);
+            quint32 shade = shadeTable[idx];
+            colr = colr - qMin(shade, colr);
+            colg = colg - qMin(shade, colg);
+            colb = colb - qMin(shade, colb);
           }
-          if (section2) {
-            blid2 = section2->getPaletteEntry(offset, y+2).hid;
+
+          // only set when scanned with RenderSettings::MobSpawn
+          if (sample->spawn & ChunkGBuffer::SpawnOnTop) {
+            colr = (colr + 256) / 2;
+            colg = (colg + 0) / 2;
+            colb = (colb + 192) / 2;
           }
-          if (sectionB) {
-            blidB = sectionB->getPaletteEntry(offset, y-1).hid;
+          if (sample->spawn & ChunkGBuffer::SpawnInside) {
+            colr = (colr + 192) / 2;
+            colg = (colg + 0) / 2;
+            colb = (colb + 256) / 2;
           }
-          const BlockInfo &block2 = BlockIdentifier::Instance().getBlockInfo(blid2);
-          const BlockInfo &block1 = BlockIdentifier::Instance().getBlockInfo(blid1);
-          const BlockInfo &block0 = block;
-          const BlockInfo &blockB = BlockIdentifier::Instance().getBlockInfo(blidB);
-          int light0 = section->getBlockLight(offset, y);
-
-           // spawn check #1: on top of solid block
-           if (block0.doesBlockHaveSolidTopSurface() &&
-               !block0.isBedrock() && light1 < 8 &&
-               !block1.isBlockNormalCube() && block1.spawninside &&
-               !block1.isLiquid() &&
-               !block2.isBlockNormalCube() && block2.spawninside) {
-             colr = (colr + 256) / 2;
-             colg = (colg + 0) / 2;
-             colb = (colb + 192) / 2;
-           }
-           // spawn check #2: current block is transparent,
-           // but mob can spawn through (e.g. snow)
-           if (blockB.doesBlockHaveSolidTopSurface() &&
-               !blockB.isBedrock() && light0 < 8 &&
-               !block0.isBlockNormalCube() && block0.spawninside &&
-               !block0.isLiquid() &&
-               !block1.isBlockNormalCube() && block1.spawninside) {
-             colr = (colr + 192) / 2;
-             colg = (colg + 0) / 2;
-             colb = (colb + 256) / 2;
-           }
-        }
-        if (flags & MapView::flgBiomeColors) {
-          colr = biome.colors[light].red();
-          colg = biome.colors[light].green();
-          colb = biome.colors[light].blue();
-          alpha = 0;
-        }
-
-        // combine current block to final color
-        if (alpha == 0.0) {
-          // first color sample
-          alpha = block.alpha;
-          r = colr;
-          g = colg;
-          b = colb;
-          highest = y;
-        } else {
-          // combine further color samples with blending
-          r = (quint8)(alpha * r + (1.0 - alpha) * colr);
-          g = (quint8)(alpha * g + (1.0 - alpha) * colg);
-          b = (quint8)(alpha * b + (1.0 - alpha) * colb);
-          alpha += block.alpha * (1.0 - alpha);
-        }
 
-        // finish depth (Y) scanning when color is saturated enough
-        if (block.alpha == 1.0 || alpha > 0.9)
-          break;
+          // combine current block to final color
+          if (alpha == 0) {
+            // first color sample
+            alpha = block.fixedAlpha;
+            r = colr;
+            g = colg;
+            b = colb;
+          } else {
+            // combine further color samples with blending, in 15 bit fixed-point
+            const qint32 rest = One - alpha;
+            r = (quint8)((alpha * r + rest * colr) >> 15);
+            g = (quint8)((alpha * g + rest * colg) >> 15);
+            b = (quint8)((alpha * b + rest * colb) >> 15);
+            alpha += (block.fixedAlpha * rest) >> 15;
+          }
+        } // top -> down
+      }
 
-      } // top -> down
-
-      if (flags & MapView::flgCaveMode) {
-        float cave_factor = 1.0;
-        int cave_test = 0;
-        for (int y=highest-1; (y >= 0) && (cave_test < CaveShade::CAVE_DEPTH); y--, cave_test++) {  // top->down
-          // get section
-          ChunkSection *section = chunk->sections[y >> 4];
-          if (!section) continue;
-          // get data value
-          // int data = section->getData(offset, y);
-          // get BlockInfo from block value
-          const BlockInfo &block = BlockIdentifier::Instance().getBlockInfo(section->getPaletteEntry(offset, y).hid);
-          if (block.transparent) {
-            cave_factor -= CaveShade::getShade(cave_test);
+      if (caveMask != 0)
+        dependencies.flags |= RenderSettings::CaveMode;
+      if (Flags & RenderSettings::CaveMode) {
+        static const FixedCaveShade caveShade;
+        qint32 cave_factor = One;
+        for (int cave_test = 0; cave_test < CaveShade::CAVE_DEPTH; cave_test++) {
+          if (caveMask & (1 << cave_test)) {
+            cave_factor -= caveShade.shade[cave_test];
           }
         }
-        cave_factor = std::max(cave_factor,0.25f);
+        cave_factor = std::max(cave_factor, One / 4);
         // darken color by blending with cave shade factor
-        r = (quint8)(cave_factor * r);
-        g = (quint8)(cave_factor * g);
-        b = (quint8)(cave_factor * b);
+        r = (quint8)((cave_factor * r) >> 15);
+        g = (quint8)((cave_factor * g) >> 15);
+        b = (quint8)((cave_factor * b) >> 15);
       }
 
-      *depthbits++ = lasty = highest;
-      *bits++ = b;
-      *bits++ = g;
-      *bits++ = r;
-      *bits++ = 0xff;
+      depthbits[column] = lasty = highest;
+      *pixelbits++ = b;
+      *pixelbits++ = g;
+      *pixelbits++ = r;
+      *pixelbits++ = 0xff;
     }
   }
-  renderData.renderedFor.renderedAt = depth;
-  renderData.renderedFor.renderedFlags = flags;
+  return dependencies;
 }
 
+typedef QSharedPointer<const ChunkGBuffer> (*ScanKernelT)(const Chunk &, const ColumnLayerIndex &,
+                                                          const BlockRenderTablePtr &, int, int);
+typedef ShadeDependencies (*ShadeKernelT)(const ChunkGBuffer &, int, int, const ChunkEdgeHeights &,
+                                          uchar *, int, uchar *, int);
+
+template <std::size_t... Index>
+constexpr std::array<ScanKernelT, sizeof...(Index)> createScanKernels(std::index_sequence<Index...>)
+{
+  return {{ &scanKernel<scanFlagsFromIndex(Index)>... }};
+}
+
+template <std::size_t... Index>
+constexpr std::array<ShadeKernelT, sizeof...(Index)> createShadeKernels(std::index_sequence<Index...>)
+{
+  return {{ &shadeKernel<shadeFlagsFromIndex(Index)>... }};
+}
+
+const std::array<ScanKernelT, 1 << ScanFlagCount> s_scanKernels =
+    createScanKernels(std::make_index_sequence<1 << ScanFlagCount>());
+const std::array<ShadeKernelT, 1 << ShadeFlagCount> s_shadeKernels =
+    createShadeKernels(std::make_index_sequence<1 << ShadeFlagCount>());
+
+// scans the chunk again only when the blocks or the scan parameters changed, otherwise its G-buffer is shaded
+QSharedPointer<const ChunkGBuffer> scanChunk(const QSharedPointer<Chunk>& chunk,
+                                             const QSharedPointer<const ChunkGBuffer>& cached,
+                                             int &depth, int &flags, int lod)
+{
+  QSharedPointer<const ChunkGBuffer> gbuffer = cached;
+  if (chunk && !(gbuffer && gbuffer->isValidFor(depth, flags & ScanFlagMask, lod)))
+  {
+    // all block attributes are taken from one snapshot of the definitions
+    const BlockRenderTablePtr table = BlockIdentifier::Instance().getRenderTable();
+    const QSharedPointer<const ColumnLayerIndex> layerIndex = chunk->getLayerIndex(table);
+    gbuffer = s_scanKernels[scanIndexFromFlags(flags)](*chunk, *layerIndex, table, depth, lod);
+  }
+  if (!gbuffer || !gbuffer->hasColumnsFor(lod))
+  {
+    return QSharedPointer<const ChunkGBuffer>();  // the output resolution can't be changed, leave it to a new job
+  }
+
+  // an outdated G-buffer without chunk is still shaded, the result is marked with its parameters to be redrawn
+  if (!gbuffer->isValidFor(depth, flags & ScanFlagMask, lod))
+  {
+    depth = gbuffer->depth;
+    flags = (flags & ~ScanFlagMask) | gbuffer->scanFlags;
+  }
+  return gbuffer;
+}
+
+RenderParams shadeChunk(const ChunkGBuffer& gbuffer, int depth, int flags, int lod, const ChunkEdgeHeights &westEdge,
+                        uchar *bits, int bytesPerLine, uchar *depthbits, int depthBytesPerLine)
+{
+  const ShadeDependencies shaded = s_shadeKernels[shadeIndexFromFlags(flags)](gbuffer, depth, lod, westEdge,
+                                                                              bits, bytesPerLine,
+                                                                              depthbits, depthBytesPerLine);
+
+  RenderParams renderedFor(depth, flags, lod);
+  renderedFor.minDepth = std::max(gbuffer.minDepth, shaded.minDepth);
+  renderedFor.maxDepth = std::min(gbuffer.maxDepth, shaded.maxDepth);
+  renderedFor.dependsOnFlags = gbuffer.dependsOnFlags | shaded.flags;
+  return renderedFor;
+}
+
+// the heights of the last column are what the east neighbor continues
+ChunkEdgeHeights getEastEdge(const uchar *depthbits, int depthBytesPerLine, int lod)
+{
+  const int size = ChunkID::SIZE_N / lod;
+  ChunkEdgeHeights edge = unknownEdgeHeights();
+  for (int row = 0; row < size; row++, depthbits += depthBytesPerLine)
+  {
+    edge[row] = depthbits[size - 1];
+  }
+  return edge;
+}
+
+}  // namespace
+
+
+int ChunkRenderer::getScanFlags(int flags)
+{
+  return flags & ScanFlagMask;
+}
+
+RenderParams ChunkRenderer::renderChunk(const RenderSettings &settings, const QSharedPointer<Chunk>& chunk,
+                                        uchar *bits, int bytesPerLine, uchar *depthbits, int depthBytesPerLine,
+                                        QSharedPointer<const ChunkGBuffer> *gbuffer_inout,
+                                        const ChunkEdgeHeights *westEdge)
+{
+  int depth = settings.depth;
+  int flags = settings.flags;
+
+  const QSharedPointer<const ChunkGBuffer> gbuffer =
+      scanChunk(chunk, gbuffer_inout ? *gbuffer_inout : QSharedPointer<const ChunkGBuffer>(), depth, flags,
+                settings.lod);
+  if (!gbuffer)
+  {
+    return RenderParams();
+  }
+  if (gbuffer_inout)
+  {
+    *gbuffer_inout = gbuffer;
+  }
+
+  return shadeChunk(*gbuffer, depth, flags, settings.lod, westEdge ? *westEdge : unknownEdgeHeights(),
+                    bits, bytesPerLine, depthbits, depthBytesPerLine);
+}
+
+void ChunkRenderer::renderChunk(const RenderSettings &settings, const QSharedPointer<Chunk>& chunk,
+                                RenderedChunk &rendered_out)
+{
+  RenderedChunk& renderData = rendered_out;
+
+  const QSize size = ChunkID::getSize() / settings.lod;
+  if (renderData.image.size() != size)
+  {
+    renderData.image = QImage(size, QImage::Format_RGB32);
+  }
+  if (renderData.depth.size() != size)
+  {
+    renderData.depth = QImage(size, QImage::Format_Grayscale8);
+  }
+
+  const RenderParams renderedFor =
+      renderChunk(settings, chunk,
+                  renderData.image.bits(), renderData.image.bytesPerLine(),
+                  renderData.depth.bits(), renderData.depth.bytesPerLine(), &renderData.gbuffer, &renderData.westEdge);
+  if (renderedFor.renderedAt >= 0)
+  {
+    renderData.renderedFor = renderedFor;
+    renderData.eastEdge = getEastEdge(renderData.depth.constBits(), renderData.depth.bytesPerLine(), settings.lod);
+  }
+}
+
+void ChunkRenderer::renderGroup(const RenderSettings &settings, QVector<GroupItem> &items, RenderGroupData &group)
+{
+  // west->east, so that neighbors in the job continue each other's relief
+  std::sort(items.begin(), items.end(), [](const GroupItem& a, const GroupItem& b) {
+    return std::make_pair(a.rendered->chunkZ, a.rendered->chunkX) < std::make_pair(b.rendered->chunkZ, b.rendered->chunkX);
+  });
+
+  struct Scanned
+  {
+    QSharedPointer<const ChunkGBuffer> gbuffer;
+    int depth;
+    int flags;
+    int lod;
+  };
+
+  // scanning is done without holding the group, only the shading writes into its images
+  QVector<Scanned> scanned(items.size());
+  for (int i = 0; i < items.size(); i++)
+  {
+    Scanned& s = scanned[i];
+    s.depth = settings.depth;
+    s.flags = settings.flags;
+
+    // a G-buffer that is still valid is shaded in full detail, only scanning is cut down for a preview
+    const QSharedPointer<const ChunkGBuffer>& cached = items[i].rendered->gbuffer;
+    const bool reusable = cached && cached->isValidFor(s.depth, s.flags & ScanFlagMask, settings.lod);
+    s.lod = ((settings.previewLod > settings.lod) && !reusable) ? settings.previewLod : settings.lod;
+
+    s.gbuffer = scanChunk(items[i].chunk, cached, s.depth, s.flags, s.lod);
+  }
+
+  QMutexLocker locker(&group.imageMutex);
+  group.init(settings.lod);
+  const int chunkSize = ChunkID::SIZE_N / settings.lod;
+
+  const RenderedChunk *west = nullptr;
+  bool westIsPreview = false;
+  ChunkEdgeHeights previewEdge = unknownEdgeHeights();  // east edge of the last preview, in its rows
+  for (int i = 0; i < items.size(); i++)
+  {
+    RenderedChunk& renderData = *items[i].rendered;
+    const Scanned& s = scanned[i];
+    if (!s.gbuffer)
+    {
+      west = nullptr;
+      continue;
+    }
+
+    const CoordinateID chunkInGroup = ChunkGroupID::relativeCoordinate(CoordinateID(renderData.chunkX, renderData.chunkZ));
+    const int pixelX = chunkInGroup.getX() * chunkSize;
+    const int pixelZ = chunkInGroup.getZ() * chunkSize;
+    const bool westInJob = west && (west->chunkZ == renderData.chunkZ) && (west->chunkX + 1 == renderData.chunkX);
+
+    // the west neighbor rendered in this job replaces the edge known when the job was created
+    if (westInJob)
+    {
+      renderData.westEdge = west->eastEdge;
+    }
+
+    if (s.lod != settings.lod)
+    {
+      // preview: shaded in its own resolution, each pixel is repeated. Its edges don't have the rows of the
+      // level of detail, neighbors start with unknown heights until it is refined (westEdge is still recorded,
+      // so it isn't requested again for a changed edge)
+      const int previewSize = ChunkID::SIZE_N / s.lod;
+      const int repeat = s.lod / settings.lod;
+      std::array<quint32, ChunkID::SIZE_N * ChunkID::SIZE_N> bits;
+      std::array<uchar, ChunkID::SIZE_N * ChunkID::SIZE_N> depthbits;
+
+      renderData.gbuffer = s.gbuffer;
+      renderData.renderedFor =
+          shadeChunk(*s.gbuffer, s.depth, s.flags, s.lod, (westInJob && westIsPreview) ? previewEdge : unknownEdgeHeights(),
+                     reinterpret_cast<uchar*>(bits.data()), previewSize * 4, depthbits.data(), previewSize);
+      previewEdge = getEastEdge(depthbits.data(), previewSize, s.lod);
+      renderData.eastEdge = unknownEdgeHeights();
+
+      for (int z = 0; z < chunkSize; z++)
+      {
+        quint32 *line = reinterpret_cast<quint32*>(group.renderedImg.scanLine(pixelZ + z)) + pixelX;
+        uchar *depthLine = group.depthImg.scanLine(pixelZ + z) + pixelX;
+        const int row = (z / repeat) * previewSize;
+        for (int x = 0; x < chunkSize; x++)
+        {
+          line[x] = bits[row + x / repeat];
+          depthLine[x] = depthbits[row + x / repeat];
+        }
+      }
+
+      west = &renderData;
+      westIsPreview = true;
+      continue;
+    }
+
+    uchar *depthbits = group.depthImg.scanLine(pixelZ) + pixelX;
+
+    renderData.gbuffer = s.gbuffer;
+    renderData.renderedFor =
+        shadeChunk(*s.gbuffer, s.depth, s.flags, settings.lod, renderData.westEdge,
+                   group.renderedImg.scanLine(pixelZ) + pixelX * 4, group.renderedImg.bytesPerLine(),
+                   depthbits, group.depthImg.bytesPerLine());
+    renderData.eastEdge = getEastEdge(depthbits, group.depthImg.bytesPerLine(), settings.lod);
+    west = &renderData;
+    westIsPreview = false;
+  }
+}
+
+void ChunkRenderer::renderArea(const RenderSettings &settings, const QRect &area, const ChunkSource &source,
+                               QImage &image, QImage *depth_out,
+                               QVector<QSharedPointer<const ChunkGBuffer>> *gbuffers_out)
+{
+  const int chunkSize = ChunkID::SIZE_N / settings.lod;
+  const QSize size(area.width() * chunkSize, area.height() * chunkSize);
+
+  image = QImage(size, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+  QImage depthImg(size, QImage::Format_Grayscale8);
+  depthImg.fill(0);
+  if (gbuffers_out)
+  {
+    gbuffers_out->clear();
+    gbuffers_out->reserve(area.width() * area.height());
+  }
+
+  for (int z = area.top(); z <= area.bottom(); z++)
+  {
+    const int pixelZ = (z - area.top()) * chunkSize;
+    ChunkEdgeHeights westEdge = unknownEdgeHeights();  // nothing rendered west of the area
+    for (int x = area.left(); x <= area.right(); x++)
+    {
+      const int pixelX = (x - area.left()) * chunkSize;
+      uchar *depthbits = depthImg.scanLine(pixelZ) + pixelX;
+
+      QSharedPointer<const ChunkGBuffer> gbuffer;
+      const QSharedPointer<Chunk> chunk = source(x, z);
+      RenderParams renderedFor;
+      if (chunk)
+      {
+        renderedFor = renderChunk(settings, chunk,
+                                  image.scanLine(pixelZ) + pixelX * 4, image.bytesPerLine(),
+                                  depthbits, depthImg.bytesPerLine(), &gbuffer, &westEdge);
+      }
+      westEdge = (renderedFor.renderedAt >= 0) ? getEastEdge(depthbits, depthImg.bytesPerLine(), settings.lod)
+                                               : unknownEdgeHeights();
+      if (gbuffers_out)
+      {
+        gbuffers_out->append(gbuffer);
+      }
+    }
+  }
+
+  if (depth_out)
+  {
+    *depth_out = depthImg;
+  }
+}
 
 
 // define a shading curve for Cave Mode:
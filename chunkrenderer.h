@@ -2,35 +2,60 @@
 #ifndef CHUNKRENDERER_H
 #define CHUNKRENDERER_H
 
-#include <QObject>
-#include <QRunnable>
-#include "chunkcache.h"
+#include "./rendersettings.h"
 
-#include <QObject>
-#include <QRunnable>
+#include <QImage>
+#include <QRect>
 #include <QSharedPointer>
+#include <QVector>
 
-class MapView;
-class Chunk;
+#include <functional>
 
-class ChunkRenderer: public QObject, public QRunnable {
-    Q_OBJECT
+class Chunk;
+class ChunkGBuffer;
+class RenderedChunk;
+struct RenderGroupData;
 
+// Turns chunks into images, independent of any view: everything it uses is passed in, all functions can be
+// called from any thread.
+class ChunkRenderer {
    public:
-    ChunkRenderer(const QSharedPointer<Chunk> &chunk, MapView& parent_);
-
-    ~ChunkRenderer() override;
-
-    static void renderChunk(MapView& parent, const QSharedPointer<Chunk> &chunk, RenderedChunk& rendered_out);
+    // delivers the chunk at the chunk coordinates, nullptr when there is none
+    typedef std::function<QSharedPointer<Chunk>(int chunkX, int chunkZ)> ChunkSource;
 
-   protected:
+    // one chunk of a group job
+    struct GroupItem
+    {
+      QSharedPointer<Chunk> chunk;  // nullptr: only the G-buffer of rendered is shaded
+      QSharedPointer<RenderedChunk> rendered;
+    };
 
-    void run() override;
+    // renders one chunk into (16/lod)x(16/lod) pixels of 32 bit color and 8 bit height
+    // gbuffer_inout (optional) is reused when it is still valid for the settings and receives the scanned one,
+    // with chunk == nullptr only it is shaded. westEdge continues the relief of the west neighbor.
+    // Returns what the result depends on, RenderParams() if nothing was drawn
+    static RenderParams renderChunk(const RenderSettings& settings, const QSharedPointer<Chunk> &chunk,
+                                    uchar *bits, int bytesPerLine, uchar *depthbits, int depthBytesPerLine,
+                                    QSharedPointer<const ChunkGBuffer> *gbuffer_inout = nullptr,
+                                    const ChunkEdgeHeights *westEdge = nullptr);
+    // same, into the images of rendered_out (resized to the level of detail), continuing its westEdge and
+    // setting its eastEdge
+    static void renderChunk(const RenderSettings& settings, const QSharedPointer<Chunk> &chunk,
+                            RenderedChunk& rendered_out);
+    // renders chunks of one group in one job directly into the group images. The chunks are scanned without
+    // holding the group and shaded west->east, neighbors in the job continue each other's relief.
+    // Chunks that have to be scanned again become a preview when settings.previewLod is coarser
+    static void renderGroup(const RenderSettings& settings, QVector<GroupItem>& items, RenderGroupData& group);
 
-   private:
-    QSharedPointer<Chunk> m_chunk;
-    MapView& m_parent;
+    // renders a rectangle of chunks (chunk coordinates, e.g. a region) in one pass into image (ARGB32) and
+    // depth (Grayscale8) with continuous relief shading, missing chunks stay transparent.
+    // gbuffers_out receives one entry per chunk, row by row
+    static void renderArea(const RenderSettings& settings, const QRect& area, const ChunkSource& source,
+                           QImage& image, QImage* depth_out = nullptr,
+                           QVector<QSharedPointer<const ChunkGBuffer>>* gbuffers_out = nullptr);
 
+    // the render flags a G-buffer depends on
+    static int getScanFlags(int flags);
 };
 
 class CaveShade {
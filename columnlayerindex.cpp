@@ -0,0 +1,70 @@
+#include "./columnlayerindex.h"
+#include "./blockrendertable.h"
+#include "./chunk.h"
+
+#include <algorithm>
+
+ColumnLayerIndex::ColumnLayerIndex()
+  : m_layers(16*16, Layer{255, 0})  // until built: every column is one invisible layer
+{
+  for (size_t offset = 0; offset < m_columnStart.size(); offset++)
+  {
+    m_columnStart[offset] = static_cast<quint32>(offset);
+  }
+}
+
+void ColumnLayerIndex::build(ChunkSection* const sections[16], const QSharedPointer<const BlockRenderTable>& table)
+{
+  m_table = table;
+  BlockRenderLookup lookup(*table);
+
+  // attributes of all blocks first, walking the columns through the sections would be 256 scattered passes
+  std::array<quint8, 16*16*256> flags;
+  for (int sec = 0; sec < 16; sec++)
+  {
+    const ChunkSection *section = sections[sec];
+    quint8 *sectionFlags = flags.data() + sec * 4096;
+    if (!section)
+    {
+      std::fill(sectionFlags, sectionFlags + 4096, 0);  // nothing visible, not open space in cave mode
+      continue;
+    }
+    for (int i = 0; i < 4096; i++)
+    {
+      const BlockRenderTable::Entry &block = lookup.get(*section, sec, i & 0xff, i >> 8);
+      quint8 f = 0;
+      if (block.fixedAlpha > 0)                           f |= Visible;
+      if (block.fixedAlpha == BlockRenderTable::FixedOne) f |= Opaque;
+      if (block.has(BlockRenderTable::Liquid))            f |= Liquid;
+      if (block.has(BlockRenderTable::Transparent))       f |= Transparent;
+      if (block.alpha == 1.0f || block.alpha > 0.9)       f |= Dense;
+      sectionFlags[i] = f;
+    }
+  }
+
+  m_layers.clear();
+  m_layers.reserve(16*16*4);
+  for (int offset = 0; offset < 16*16; offset++)
+  {
+    m_columnStart[offset] = static_cast<quint32>(m_layers.size());
+    int current = -1;
+    for (int y = 255; y >= 0; y--)
+    {
+      const quint8 f = flags[(y << 8) | offset];
+      if (f != current)
+      {
+        m_layers.push_back(Layer{static_cast<quint8>(y), f});
+        current = f;
+      }
+    }
+  }
+  m_columnStart[16*16] = static_cast<quint32>(m_layers.size());
+  m_layers.shrink_to_fit();
+}
+
+const ColumnLayerIndex::Layer* ColumnLayerIndex::find(int offset, int y) const
+{
+  // tops are descending and the first one is 255, the containing layer is the last one starting at or above y
+  return std::lower_bound(begin(offset), end(offset), y,
+                          [](const Layer& layer, int value) { return layer.top >= value; }) - 1;
+}
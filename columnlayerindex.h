@@ -0,0 +1,68 @@
+#ifndef COLUMNLAYERINDEX_H
+#define COLUMNLAYERINDEX_H
+
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+class BlockRenderTable;
+class ChunkSection;
+
+// Per column list of the y positions where the visible material changes, built when a chunk is decoded and
+// again when the render table was replaced since (see Chunk::getLayerIndex()).
+//
+// A column is split into layers of blocks with the same render relevant attributes. The renderer finds the
+// first visible block below any depth with a binary search and skips invisible layers (air, missing sections)
+// without probing every block.
+class ColumnLayerIndex
+{
+public:
+  enum LayerFlags : quint8
+  {
+    Visible     = 0x01,  // alpha > 0
+    Liquid      = 0x02,
+    Opaque      = 0x04,  // alpha == 1, scanning ends here
+    Transparent = 0x08,  // counts as open space in cave mode
+    Dense       = 0x10,  // alpha > 0.9, scanning with biome colors ends here
+  };
+
+  // spans from top down to the top of the next layer of the column + 1
+  struct Layer
+  {
+    quint8 top;
+    quint8 flags;
+  };
+
+  ColumnLayerIndex();
+
+  void build(ChunkSection* const sections[16], const QSharedPointer<const BlockRenderTable>& table);
+
+  // false when it was built with another render table, its layer flags are outdated then
+  bool isBuiltWith(const QSharedPointer<const BlockRenderTable>& table) const
+  {
+    return m_table.toStrongRef() == table;
+  }
+
+  // layers of one column ordered top->down, the first one starts at y=255
+  const Layer* begin(int offset) const
+  {
+    return m_layers.data() + m_columnStart[offset];
+  }
+  const Layer* end(int offset) const
+  {
+    return m_layers.data() + m_columnStart[offset + 1];
+  }
+
+  // layer of the column containing y (0..255)
+  const Layer* find(int offset, int y) const;
+
+private:
+  std::vector<Layer> m_layers;
+  std::array<quint32, 16*16 + 1> m_columnStart;
+  QWeakPointer<const BlockRenderTable> m_table;  // built with
+};
+
+#endif  // COLUMNLAYERINDEX_H
@@ -2,6 +2,9 @@
 #define CHUNKHASHMAP_H
 
 #include "coordinateid.h"
+#include "flatcoordinatehashmap.hpp"
+
+#include <array>
 
 template<class _ValueT, int reduction = 16>
 class CoordinateHashMap
@@ -14,7 +17,7 @@ public:
     ArraySize = reduction * reduction
   };
   using ArrayValueT = std::array<_ValueT, ArraySize>;
-  using BaseT = QHash<CoordinateID, ArrayValueT>;
+  using BaseT = FlatCoordinateHashMap<CoordinateID, ArrayValueT>;
 
   _ValueT& operator[](const KeyT& key)
   {
@@ -36,7 +39,7 @@ public:
   }
 
 private:
-  QHash<CoordinateID, std::array<_ValueT, reduction * reduction> > rawmap;
+  BaseT rawmap;
 };
 
 #endif // CHUNKHASHMAP_H
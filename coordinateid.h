@@ -49,28 +49,48 @@ inline size_t convertTo16Bit(int value)
   return (uval >> 16) + uval;
 }
 
+// lookup table spreading the 8 bits of a byte to the even bits of a 16 bit word
+// (used for the Morton / Z-order encoding of coordinates)
+struct MortonSpreadTable
+{
+  quint16 values[256];
+
+  constexpr MortonSpreadTable()
+    : values()
+  {
+    for (int i = 0; i < 256; i++)
+    {
+      int spread = 0;
+      for (int bit = 0; bit < 8; bit++)
+      {
+        spread |= ((i >> bit) & 1) << (2 * bit);
+      }
+      values[i] = static_cast<quint16>(spread);
+    }
+  }
+};
+
+static constexpr MortonSpreadTable mortonSpreadTable{};
+
+// spreads the lower 16 bits of value to the even bits of the result
+inline uint mortonSpread16(uint value)
+{
+  return static_cast<uint>(mortonSpreadTable.values[value & 0xff]) |
+        (static_cast<uint>(mortonSpreadTable.values[(value >> 8) & 0xff]) << 16);
+}
+
 inline uint qHash(const CoordinateID &c) {
 
   static_assert(sizeof(int) == 4, "");
-  static_assert(sizeof(size_t) == 8, "");
   static_assert(sizeof(c.getX()) == 4, "");
   static_assert(sizeof(c.getX()) == sizeof(uint), "");
   static_assert(std::numeric_limits<uint>::max() == 0xFFFFFFFF, "");
 
-  const int halfbits = 16;
-  const size_t n1 = convertTo16Bit(c.getX());
-  const size_t n2 = convertTo16Bit(c.getZ());
-  uint result = 0;
-  for (size_t i = 0; i < halfbits; i++)
-  {
-    size_t bitA = (n1 & (1 << i)) << (i+0);
-    size_t bitB = (n2 & (1 << i)) << (i+1);
-
-    result |= bitA;
-    result |= bitB;
-  }
+  // interleave X (even bits) and Z (odd bits) -> spatially close coordinates get close hash values
+  const uint n1 = static_cast<uint>(convertTo16Bit(c.getX()));
+  const uint n2 = static_cast<uint>(convertTo16Bit(c.getZ()));
 
-  return result;
+  return mortonSpread16(n1) | (mortonSpread16(n2) << 1);
 }
 
 class RectangleIterator: public CoordinateID
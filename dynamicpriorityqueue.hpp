@@ -0,0 +1,182 @@
+#ifndef DYNAMICPRIORITYQUEUE_HPP
+#define DYNAMICPRIORITYQUEUE_HPP
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// all items have the same priority -> plain FIFO order
+struct ConstantPriorityKey
+{
+  struct EvaluatorT {};
+
+  template<typename T>
+  EvaluatorT evaluatorOf(const T&) const
+  {
+    return EvaluatorT();
+  }
+
+  template<typename T>
+  double operator()(const T&) const
+  {
+    return 0.0;
+  }
+};
+
+// Priority queue whose keys can change while the items are queued (not thread safe, except rekey()).
+//
+// Items are pushed with their key, smaller keys are popped first and items with equal keys keep their FIFO order.
+// The owner calculates the key with keyOf() before it locks the queue, because key functions may take other locks.
+// When the owner changes the generation number, rekey() evaluates the keys without holding the lock and applies
+// them to the items that are still queued. Only the evaluators are copied for that, KeyFunctionT provides:
+//   double operator()(const T&): the key of an item
+//   EvaluatorT evaluatorOf(const T&): what the key depends on, cheap to copy
+//   double operator()(const EvaluatorT&): the key
+template<typename T, typename KeyFunctionT = ConstantPriorityKey>
+class DynamicPriorityQueue
+{
+public:
+  explicit DynamicPriorityQueue(const KeyFunctionT& keyFunction = KeyFunctionT())
+    : m_keyFunction(keyFunction)
+    , m_sequence(0)
+    , m_generation(0)
+  {}
+
+  double keyOf(const T& item) const
+  {
+    return m_keyFunction(item);
+  }
+
+  void push(T&& item, double key)
+  {
+    m_heap.push_back(Entry{key, m_sequence++, std::move(item)});
+    std::push_heap(m_heap.begin(), m_heap.end(), Later());
+  }
+
+  bool pop(T& item)
+  {
+    double key;
+    return pop(item, key);
+  }
+
+  // key is the one the item was sorted by
+  bool pop(T& item, double& key)
+  {
+    if (m_heap.empty())
+    {
+      return false;
+    }
+
+    std::pop_heap(m_heap.begin(), m_heap.end(), Later());
+    key = m_heap.back().key;
+    item = std::move(m_heap.back().item);
+    m_heap.pop_back();
+    return true;
+  }
+
+  // key of the item popped next, false when empty
+  bool topKey(double& key) const
+  {
+    if (m_heap.empty())
+    {
+      return false;
+    }
+
+    key = m_heap.front().key;
+    return true;
+  }
+
+  // the key function is kept, a running rekey() doesn't apply its keys to items pushed afterwards
+  void clear()
+  {
+    m_heap.clear();
+    m_generation = 0;
+  }
+
+  bool empty() const
+  {
+    return m_heap.empty();
+  }
+
+  size_t size() const
+  {
+    return m_heap.size();
+  }
+
+  // evaluates all keys again when generation changed since the last call,
+  // mutex protects the queue and is only locked to copy the items and to apply the keys
+  template<typename MutexT>
+  void rekey(MutexT& mutex, size_t generation)
+  {
+    std::vector<std::pair<unsigned long long, EvaluatorT> > evaluators;
+    {
+      std::lock_guard<MutexT> guard(mutex);
+      if (generation == m_generation)
+      {
+        return;
+      }
+      m_generation = generation;
+      evaluators.reserve(m_heap.size());
+      for (const auto& entry: m_heap)
+      {
+        evaluators.emplace_back(entry.sequence, m_keyFunction.evaluatorOf(entry.item));
+      }
+    }
+
+    std::vector<std::pair<unsigned long long, double> > keys;  // sequence -> key, sorted by sequence
+    keys.reserve(evaluators.size());
+    for (const auto& evaluator: evaluators)
+    {
+      keys.emplace_back(evaluator.first, m_keyFunction(evaluator.second));
+    }
+    evaluators.clear();
+    std::sort(keys.begin(), keys.end());
+
+    std::lock_guard<MutexT> guard(mutex);
+    if (generation != m_generation)
+    {
+      return;  // a newer generation was started meanwhile, its keys win
+    }
+
+    // items pushed meanwhile got their key with the current generation already
+    for (auto& entry: m_heap)
+    {
+      const auto it = std::lower_bound(keys.begin(), keys.end(), entry.sequence,
+                                       [](const std::pair<unsigned long long, double>& a, unsigned long long sequence) {
+                                         return a.first < sequence;
+                                       });
+      if ((it != keys.end()) && (it->first == entry.sequence))
+      {
+        entry.key = it->second;
+      }
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), Later());
+  }
+
+private:
+  typedef typename KeyFunctionT::EvaluatorT EvaluatorT;
+
+  struct Entry
+  {
+    double key;
+    unsigned long long sequence;
+    T item;
+  };
+
+  // heap comparison: true when a has to be executed after b
+  struct Later
+  {
+    bool operator()(const Entry& a, const Entry& b) const
+    {
+      return (a.key > b.key) || ((a.key == b.key) && (a.sequence > b.sequence));
+    }
+  };
+
+  KeyFunctionT m_keyFunction;
+  std::vector<Entry> m_heap;
+  unsigned long long m_sequence;
+  size_t m_generation;
+};
+
+#endif // DYNAMICPRIORITYQUEUE_HPP
@@ -73,6 +73,11 @@ Entity::Point Entity::midpoint() const {
     return pos;
 }
 
+void Entity::getBounds(Point& min, Point& max) const {
+  min = pos;
+  max = pos;
+}
+
 Entity::Entity(const PlayerInfo &player)
     : extraColor(Qt::red)
     , pos(player.currentPosition)
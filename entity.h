@@ -16,6 +16,7 @@ class Entity: public OverlayItem {
   virtual void draw(double offsetX, double offsetZ, double scale,
                     QPainter *canvas) const;
   virtual Point midpoint() const;
+  virtual void getBounds(Point& min, Point& max) const;
   void setExtraColor(const QColor& c) {extraColor = c;}
 
   static const int RADIUS = 5;
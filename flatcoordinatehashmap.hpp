@@ -0,0 +1,302 @@
+#ifndef FLATCOORDINATEHASHMAP_HPP
+#define FLATCOORDINATEHASHMAP_HPP
+
+#include "coordinateid.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+// Open addressing hash map specialized for CoordinateID like keys (CoordinateID, ChunkID, ChunkGroupID).
+//
+// Keys are stored in buckets of 8 entries, which is exactly one 64 byte cache line.
+// The bucket index is derived from the Morton code of the key, so a 2x4 block of neighboring coordinates
+// shares one bucket, while the blocks are scattered over the table. On collision the next bucket is probed (linear probing).
+// There is no removal of single entries, only clear() - this is all the users need
+// and keeps lookup simple: a search stops at the first bucket that is not completely filled.
+template<class _KeyT, class _ValueT>
+class FlatCoordinateHashMap
+{
+public:
+  enum {
+    BucketSlots = 8,
+    CacheLineSize = 64
+  };
+
+  static_assert(sizeof(_KeyT) * BucketSlots == CacheLineSize, "one bucket of keys should fill one cache line");
+
+  FlatCoordinateHashMap()
+    : m_keys(nullptr)
+    , m_bucketMask(0)
+    , m_size(0)
+  {}
+
+  ~FlatCoordinateHashMap()
+  {
+    freeKeys();
+  }
+
+  FlatCoordinateHashMap(const FlatCoordinateHashMap& other)
+    : FlatCoordinateHashMap()
+  {
+    operator=(other);
+  }
+
+  FlatCoordinateHashMap& operator=(const FlatCoordinateHashMap& other)
+  {
+    if (this != &other)
+    {
+      freeKeys();
+      m_used = other.m_used;
+      m_values = other.m_values;
+      m_bucketMask = other.m_bucketMask;
+      m_size = other.m_size;
+      if (other.m_keys)
+      {
+        allocateKeys(m_used.size());
+        std::copy(other.m_keys, other.m_keys + capacity(), m_keys);
+      }
+    }
+    return *this;
+  }
+
+  // returns the value of key, inserts a default constructed value when key is unknown
+  _ValueT& operator[](const _KeyT& key)
+  {
+    if ((m_size + 1) * 4 > capacity() * 3)
+    {
+      rehash(qMax<size_t>(2 * m_used.size(), 16));
+    }
+
+    for (size_t bucket = firstBucket(key); ; bucket = (bucket + 1) & m_bucketMask)
+    {
+      const int slot = findSlot(bucket, key);
+      if (slot >= 0)
+      {
+        return m_values[bucket * BucketSlots + slot];
+      }
+
+      const quint8 used = m_used[bucket];
+      if (used != 0xff)
+      {
+        const int freeSlot = firstFreeSlot(used);
+        const size_t index = bucket * BucketSlots + freeSlot;
+        m_used[bucket] = used | (1 << freeSlot);
+        m_keys[index] = key;
+        m_values[index] = _ValueT();  // slot might contain data from before clear()
+        m_size++;
+        return m_values[index];
+      }
+    }
+  }
+
+  const _ValueT* find(const _KeyT& key) const
+  {
+    if (m_size == 0)
+    {
+      return nullptr;
+    }
+
+    for (size_t bucket = firstBucket(key); ; bucket = (bucket + 1) & m_bucketMask)
+    {
+      const int slot = findSlot(bucket, key);
+      if (slot >= 0)
+      {
+        return &m_values[bucket * BucketSlots + slot];
+      }
+
+      if (m_used[bucket] != 0xff)
+      {
+        return nullptr;
+      }
+    }
+  }
+
+  _ValueT* find(const _KeyT& key)
+  {
+    return const_cast<_ValueT*>(static_cast<const FlatCoordinateHashMap*>(this)->find(key));
+  }
+
+  bool contains(const _KeyT& key) const
+  {
+    return find(key) != nullptr;
+  }
+
+  _ValueT value(const _KeyT& key, const _ValueT& defaultValue = _ValueT()) const
+  {
+    const _ValueT* v = find(key);
+    return v ? *v : defaultValue;
+  }
+
+  void reserve(int count)
+  {
+    const size_t neededSlots = (static_cast<size_t>(qMax(count, 0)) * 4) / 3 + 1;
+    size_t buckets = 16;
+    while (buckets * BucketSlots < neededSlots)
+    {
+      buckets *= 2;
+    }
+
+    if (buckets > m_used.size())
+    {
+      rehash(buckets);
+    }
+  }
+
+  // removes all entries, but keeps the allocated memory
+  void clear()
+  {
+    std::fill(m_used.begin(), m_used.end(), 0);
+    m_size = 0;
+  }
+
+  int size() const
+  {
+    return static_cast<int>(m_size);
+  }
+
+  bool isEmpty() const
+  {
+    return m_size == 0;
+  }
+
+  // calls functor(key, value) for every entry
+  template<class _FunctorT>
+  void forEach(_FunctorT functor) const
+  {
+    for (size_t bucket = 0; bucket < m_used.size(); bucket++)
+    {
+      const quint8 used = m_used[bucket];
+      for (int slot = 0; slot < BucketSlots; slot++)
+      {
+        if (used & (1 << slot))
+        {
+          const size_t index = bucket * BucketSlots + slot;
+          functor(m_keys[index], m_values[index]);
+        }
+      }
+    }
+  }
+
+  template<class _FunctorT>
+  void forEach(_FunctorT functor)
+  {
+    for (size_t bucket = 0; bucket < m_used.size(); bucket++)
+    {
+      const quint8 used = m_used[bucket];
+      for (int slot = 0; slot < BucketSlots; slot++)
+      {
+        if (used & (1 << slot))
+        {
+          const size_t index = bucket * BucketSlots + slot;
+          functor(static_cast<const _KeyT&>(m_keys[index]), m_values[index]);
+        }
+      }
+    }
+  }
+
+private:
+  _KeyT* m_keys;                  // cache line aligned, BucketSlots keys per bucket
+  std::vector<quint8> m_used;     // one bit per slot of a bucket
+  std::vector<_ValueT> m_values;
+  size_t m_bucketMask;
+  size_t m_size;
+
+  size_t capacity() const
+  {
+    return m_used.size() * BucketSlots;
+  }
+
+  size_t firstBucket(const _KeyT& key) const
+  {
+    // the lower 3 bits of the Morton code select a 2x4 block of coordinates -> one bucket,
+    // the blocks are scattered (Fibonacci hashing), consecutive blocks of a dense area would form long probe chains
+    return (static_cast<quint64>(qHash(key) >> 3) * 0x9E3779B97F4A7C15ull >> 32) & m_bucketMask;
+  }
+
+  int findSlot(size_t bucket, const _KeyT& key) const
+  {
+    const _KeyT* keys = &m_keys[bucket * BucketSlots];
+
+    // compare all slots without early exit, the compiler can turn this into a few vector ops
+    uint match = 0;
+    for (int slot = 0; slot < BucketSlots; slot++)
+    {
+      match |= static_cast<uint>(keys[slot] == key) << slot;
+    }
+    match &= m_used[bucket];
+
+    for (int slot = 0; slot < BucketSlots; slot++)
+    {
+      if (match & (1 << slot))
+      {
+        return slot;
+      }
+    }
+    return -1;
+  }
+
+  static int firstFreeSlot(quint8 used)
+  {
+    int slot = 0;
+    while (used & (1 << slot))
+    {
+      slot++;
+    }
+    return slot;
+  }
+
+  void allocateKeys(size_t buckets)
+  {
+    void* memory = qMallocAligned(buckets * BucketSlots * sizeof(_KeyT), CacheLineSize);
+    if (!memory)
+    {
+      throw std::bad_alloc();
+    }
+
+    m_keys = static_cast<_KeyT*>(memory);
+    for (size_t i = 0; i < buckets * BucketSlots; i++)
+    {
+      new (&m_keys[i]) _KeyT();
+    }
+  }
+
+  void freeKeys()
+  {
+    qFreeAligned(m_keys);  // keys are trivially destructible
+    m_keys = nullptr;
+  }
+
+  void rehash(size_t newBuckets)
+  {
+    _KeyT* oldKeys = m_keys;
+    std::vector<quint8> oldUsed;
+    std::vector<_ValueT> oldValues;
+    oldUsed.swap(m_used);
+    oldValues.swap(m_values);
+
+    allocateKeys(newBuckets);
+    m_used.assign(newBuckets, 0);
+    m_values.resize(newBuckets * BucketSlots);
+    m_bucketMask = newBuckets - 1;
+    m_size = 0;
+
+    for (size_t bucket = 0; bucket < oldUsed.size(); bucket++)
+    {
+      for (int slot = 0; slot < BucketSlots; slot++)
+      {
+        if (oldUsed[bucket] & (1 << slot))
+        {
+          const size_t index = bucket * BucketSlots + slot;
+          operator[](oldKeys[index]) = std::move(oldValues[index]);
+        }
+      }
+    }
+
+    qFreeAligned(oldKeys);
+  }
+};
+
+#endif // FLATCOORDINATEHASHMAP_HPP
@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "./flatteningconverter.h"
+#include "./blockidentifier.h"
 #include "./json.h"
 
 
@@ -39,6 +40,8 @@ int FlatteningConverter::addDefinitions(JSONArray *defs, int pack) {
   int len = defs->length();
   for (int i = 0; i < len; i++)
     parseDefinition(dynamic_cast<JSONObject *>(defs->at(i)), NULL, pack);
+  // legacy chunks are rendered through the mapping of this palette
+  BlockIdentifier::Instance().invalidateRenderTable();
   return pack;
 }
 
@@ -124,3 +124,8 @@ void GeneratedStructure::draw(double offsetX, double offsetZ, double scale,
 GeneratedStructure::Point GeneratedStructure::midpoint() const {
   return Point((p1.x + p2.x) / 2, (p1.y + p2.y) / 2, (p1.z + p2.z) / 2);
 }
+
+void GeneratedStructure::getBounds(Point& min, Point& max) const {
+  min = p1;
+  max = p2;
+}
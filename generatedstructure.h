@@ -19,6 +19,7 @@ class GeneratedStructure: public OverlayItem {
   virtual void draw(double offsetX, double offsetZ, double scale,
                    QPainter *canvas) const;
   virtual Point midpoint() const;
+  virtual void getBounds(Point& min, Point& max) const;
 
   GeneratedStructure() {}
 
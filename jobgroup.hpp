@@ -0,0 +1,85 @@
+#ifndef JOBGROUP_HPP
+#define JOBGROUP_HPP
+
+#include <boost/noncopyable.hpp>
+#include <QSharedPointer>
+
+#include <future>
+#include <mutex>
+
+// Jobs of a PriorityThreadPool that can be cancelled together.
+//
+// Cancelling is O(1): it only marks the group. Queued jobs of a cancelled group are not executed,
+// workers discard them when they reach them (their onDropped handler is still called for bookkeeping).
+// The future returned by cancel() becomes ready once the jobs of the group that were already
+// running have finished - so the caller can decide whether and when to wait for them.
+class JobGroup: public boost::noncopyable
+{
+public:
+  JobGroup()
+    : m_canceled(false)
+    , m_running(0)
+    , m_idleSignaled(false)
+  {
+    m_idleFuture = m_idlePromise.get_future().share();
+  }
+
+  static QSharedPointer<JobGroup> create()
+  {
+    return QSharedPointer<JobGroup>::create();
+  }
+
+  bool isCanceled() const
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_canceled;
+  }
+
+  std::shared_future<void> cancel()
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_canceled = true;
+    signalIdleWhenDone_unprotected();
+    return m_idleFuture;
+  }
+
+  // used by the thread pool around the execution of a job of this group
+  bool tryStartJob()
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_canceled)
+    {
+      return false;
+    }
+    m_running++;
+    return true;
+  }
+
+  void jobFinished()
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_running--;
+    signalIdleWhenDone_unprotected();
+  }
+
+private:
+  mutable std::mutex m_mutex;
+  bool m_canceled;
+  size_t m_running;
+  bool m_idleSignaled;
+  std::promise<void> m_idlePromise;
+  std::shared_future<void> m_idleFuture;
+
+  void signalIdleWhenDone_unprotected()
+  {
+    if (m_canceled && (m_running == 0) && !m_idleSignaled)
+    {
+      m_idleSignaled = true;
+      m_idlePromise.set_value();
+    }
+  }
+};
+
+using JobGroupPtr = QSharedPointer<JobGroup>;
+
+#endif // JOBGROUP_HPP
@@ -0,0 +1,283 @@
+#include "./jobmetrics.h"
+
+#include <QJsonArray>
+
+#include <algorithm>
+#include <cmath>
+
+QString toString(JobClass jobClass)
+{
+  switch (jobClass)
+  {
+    case JobClass::load:
+      return "load";
+    case JobClass::render:
+      return "render";
+    case JobClass::search:
+      return "search";
+    case JobClass::other:
+      break;
+  }
+  return "other";
+}
+
+double LatencyHistogramSnapshot::meanUs() const
+{
+  return (count > 0) ? (totalUs / count) : 0.0;
+}
+
+double LatencyHistogramSnapshot::percentileUs(double fraction) const
+{
+  if (count == 0)
+  {
+    return 0.0;
+  }
+
+  const double threshold = fraction * count;
+  quint64 sum = 0;
+  for (size_t i = 0; i < buckets.size(); i++)
+  {
+    sum += buckets[i];
+    if (sum >= threshold)
+    {
+      return LatencyHistogram::bucketUpperBoundUs(i);
+    }
+  }
+  return LatencyHistogram::bucketUpperBoundUs(buckets.size() - 1);
+}
+
+QJsonObject LatencyHistogramSnapshot::toJson() const
+{
+  QJsonArray bucketArray;
+  for (quint64 bucket: buckets)
+  {
+    bucketArray.append(static_cast<double>(bucket));
+  }
+
+  QJsonObject json;
+  json["count"] = static_cast<double>(count);
+  json["meanUs"] = meanUs();
+  json["p50Us"] = percentileUs(0.5);
+  json["p90Us"] = percentileUs(0.9);
+  json["p99Us"] = percentileUs(0.99);
+  json["log2Buckets"] = bucketArray;
+  return json;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void LatencyHistogram::record(DurationT duration)
+{
+  const quint64 us = static_cast<quint64>(std::max<qint64>(
+                       std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0));
+
+  // index of the highest set bit + 1
+  size_t bucket = 0;
+  for (quint64 remaining = us; remaining > 0; remaining >>= 1)
+  {
+    bucket++;
+  }
+
+  m_buckets[std::min(bucket, BucketCount - 1)].fetch_add(1, std::memory_order_relaxed);
+  m_totalUs.fetch_add(us, std::memory_order_relaxed);
+}
+
+LatencyHistogramSnapshot LatencyHistogram::snapshot() const
+{
+  LatencyHistogramSnapshot result;
+  result.count = 0;
+  result.totalUs = m_totalUs.load(std::memory_order_relaxed);
+  for (const auto& bucket: m_buckets)
+  {
+    const quint64 value = bucket.load(std::memory_order_relaxed);
+    result.buckets.push_back(value);
+    result.count += value;
+  }
+  return result;
+}
+
+void LatencyHistogram::reset()
+{
+  for (auto& bucket: m_buckets)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  m_totalUs.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::bucketUpperBoundUs(size_t bucket)
+{
+  return std::ldexp(1.0, static_cast<int>(bucket));
+}
+
+QJsonObject JobClassMetricsSnapshot::toJson() const
+{
+  QJsonObject json;
+  json["class"] = toString(jobClass);
+  json["enqueued"] = static_cast<double>(enqueued);
+  json["executed"] = static_cast<double>(executed);
+  json["cancelledBeforeRun"] = static_cast<double>(cancelledBeforeRun);
+  json["queued"] = static_cast<double>(queued);
+  json["running"] = static_cast<double>(running);
+  json["queueWait"] = queueWait.toJson();
+  json["runTime"] = runTime.toJson();
+  return json;
+}
+
+double ThreadPoolMetricsSnapshot::utilization() const
+{
+  if (workerBusySeconds.empty() || (uptimeSeconds <= 0.0))
+  {
+    return 0.0;
+  }
+
+  double busy = 0.0;
+  for (double seconds: workerBusySeconds)
+  {
+    busy += seconds;
+  }
+  return busy / (uptimeSeconds * workerBusySeconds.size());
+}
+
+double ThreadPoolMetricsSnapshot::utilizationSince(const ThreadPoolMetricsSnapshot& previous) const
+{
+  const double interval = uptimeSeconds - previous.uptimeSeconds;
+  if (workerBusySeconds.empty() || (interval <= 0.0) || (previous.workerBusySeconds.size() != workerBusySeconds.size()))
+  {
+    return utilization();  // previous snapshot was taken before a reset
+  }
+
+  double busy = 0.0;
+  for (size_t i = 0; i < workerBusySeconds.size(); i++)
+  {
+    busy += workerBusySeconds[i] - previous.workerBusySeconds[i];
+  }
+  return std::max(busy, 0.0) / (interval * workerBusySeconds.size());
+}
+
+QJsonObject ThreadPoolMetricsSnapshot::toJson() const
+{
+  QJsonArray workers;
+  for (double seconds: workerBusySeconds)
+  {
+    workers.append(seconds);
+  }
+
+  QJsonArray classes;
+  for (const auto& jobClass: jobClasses)
+  {
+    classes.append(jobClass.toJson());
+  }
+
+  QJsonObject json;
+  json["uptimeSeconds"] = uptimeSeconds;
+  json["utilization"] = utilization();
+  json["workerBusySeconds"] = workers;
+  json["jobClasses"] = classes;
+  return json;
+}
+
+ThreadPoolMetrics::ThreadPoolMetrics(size_t numberOfWorkers)
+{
+  for (size_t i = 0; i < numberOfWorkers; i++)
+  {
+    m_workerBusyNs.push_back(std::make_unique<std::atomic<quint64> >(0));
+  }
+
+  for (auto& perClass: m_classes)
+  {
+    perClass.queued.store(0);
+    perClass.running.store(0);
+  }
+
+  reset();
+}
+
+void ThreadPoolMetrics::jobEnqueued(JobClass jobClass)
+{
+  auto& perClass = get(jobClass);
+  perClass.enqueued.fetch_add(1, std::memory_order_relaxed);
+  perClass.queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPoolMetrics::jobStarted(JobClass jobClass, ClockT::duration queueWait)
+{
+  auto& perClass = get(jobClass);
+  perClass.queued.fetch_sub(1, std::memory_order_relaxed);
+  perClass.running.fetch_add(1, std::memory_order_relaxed);
+  perClass.queueWait.record(queueWait);
+}
+
+void ThreadPoolMetrics::jobFinished(JobClass jobClass, ClockT::duration runTime)
+{
+  auto& perClass = get(jobClass);
+  perClass.running.fetch_sub(1, std::memory_order_relaxed);
+  perClass.executed.fetch_add(1, std::memory_order_relaxed);
+  perClass.runTime.record(runTime);
+}
+
+void ThreadPoolMetrics::jobCancelled(JobClass jobClass)
+{
+  auto& perClass = get(jobClass);
+  perClass.queued.fetch_sub(1, std::memory_order_relaxed);
+  perClass.cancelledBeforeRun.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPoolMetrics::workerBusy(size_t workerIndex, ClockT::duration busy)
+{
+  m_workerBusyNs[workerIndex]->fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count(),
+                                         std::memory_order_relaxed);
+}
+
+ThreadPoolMetricsSnapshot ThreadPoolMetrics::snapshot() const
+{
+  ThreadPoolMetricsSnapshot result;
+
+  const ClockT::duration uptime = ClockT::now().time_since_epoch() - ClockT::duration(m_startTime.load());
+  result.uptimeSeconds = std::chrono::duration<double>(uptime).count();
+
+  for (const auto& busyNs: m_workerBusyNs)
+  {
+    result.workerBusySeconds.push_back(busyNs->load(std::memory_order_relaxed) * 1e-9);
+  }
+
+  for (size_t i = 0; i < JobClassCount; i++)
+  {
+    const auto& perClass = m_classes[i];
+
+    JobClassMetricsSnapshot classSnapshot;
+    classSnapshot.jobClass = static_cast<JobClass>(i);
+    classSnapshot.enqueued = perClass.enqueued.load(std::memory_order_relaxed);
+    classSnapshot.executed = perClass.executed.load(std::memory_order_relaxed);
+    classSnapshot.cancelledBeforeRun = perClass.cancelledBeforeRun.load(std::memory_order_relaxed);
+    classSnapshot.queued = perClass.queued.load(std::memory_order_relaxed);
+    classSnapshot.running = perClass.running.load(std::memory_order_relaxed);
+    classSnapshot.queueWait = perClass.queueWait.snapshot();
+    classSnapshot.runTime = perClass.runTime.snapshot();
+    result.jobClasses.push_back(classSnapshot);
+  }
+
+  return result;
+}
+
+void ThreadPoolMetrics::reset()
+{
+  for (auto& perClass: m_classes)
+  {
+    perClass.enqueued.store(0);
+    perClass.executed.store(0);
+    perClass.cancelledBeforeRun.store(0);
+    perClass.queueWait.reset();
+    perClass.runTime.reset();
+  }
+
+  for (auto& busyNs: m_workerBusyNs)
+  {
+    busyNs->store(0);
+  }
+
+  m_startTime.store(ClockT::now().time_since_epoch().count());
+}
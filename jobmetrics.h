@@ -0,0 +1,130 @@
+#ifndef JOBMETRICS_H
+#define JOBMETRICS_H
+
+#include <QJsonObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// kind of work a job of the PriorityThreadPool belongs to, metrics are collected per class
+enum class JobClass
+{
+  other,
+  load,
+  render,
+  search
+};
+
+static const size_t JobClassCount = 4;
+
+QString toString(JobClass jobClass);
+
+struct LatencyHistogramSnapshot
+{
+  std::vector<quint64> buckets;
+  quint64 count;
+  double totalUs;
+
+  double meanUs() const;
+  // upper bound of the bucket that contains the given fraction (0..1) of all samples
+  double percentileUs(double fraction) const;
+
+  QJsonObject toJson() const;
+};
+
+// Lock free histogram of durations with power of two buckets:
+// bucket 0 counts durations below 1 us, bucket i counts durations in [2^(i-1), 2^i) us.
+class LatencyHistogram
+{
+public:
+  typedef std::chrono::steady_clock::duration DurationT;
+
+  static const size_t BucketCount = 32;  // last bucket: everything above ~18 minutes
+
+  LatencyHistogram();
+
+  void record(DurationT duration);
+  LatencyHistogramSnapshot snapshot() const;
+  void reset();
+
+  static double bucketUpperBoundUs(size_t bucket);
+
+private:
+  std::array<std::atomic<quint64>, BucketCount> m_buckets;
+  std::atomic<quint64> m_totalUs;
+};
+
+struct JobClassMetricsSnapshot
+{
+  JobClass jobClass;
+  quint64 enqueued;
+  quint64 executed;
+  quint64 cancelledBeforeRun;  // cancelled group or obsolete priority -> job was never executed
+  quint64 queued;              // in flight: waiting in the queues of the pool
+  quint64 running;             // in flight: currently executed by a worker
+  LatencyHistogramSnapshot queueWait;
+  LatencyHistogramSnapshot runTime;
+
+  QJsonObject toJson() const;
+};
+
+struct ThreadPoolMetricsSnapshot
+{
+  double uptimeSeconds;                   // since creation or last reset
+  std::vector<double> workerBusySeconds;  // per worker, since creation or last reset
+  std::vector<JobClassMetricsSnapshot> jobClasses;
+
+  // average over all workers, busySeconds / uptimeSeconds
+  double utilization() const;
+  // average over all workers between two snapshots
+  double utilizationSince(const ThreadPoolMetricsSnapshot& previous) const;
+
+  QJsonObject toJson() const;
+};
+
+// Counters of a PriorityThreadPool, updated by the workers without locking.
+class ThreadPoolMetrics
+{
+public:
+  typedef std::chrono::steady_clock ClockT;
+
+  explicit ThreadPoolMetrics(size_t numberOfWorkers);
+
+  void jobEnqueued(JobClass jobClass);
+  void jobStarted(JobClass jobClass, ClockT::duration queueWait);
+  void jobFinished(JobClass jobClass, ClockT::duration runTime);
+  void jobCancelled(JobClass jobClass);
+  void workerBusy(size_t workerIndex, ClockT::duration busy);
+
+  ThreadPoolMetricsSnapshot snapshot() const;
+
+  // restarts counters, histograms and utilization - the in flight numbers are kept
+  void reset();
+
+private:
+  struct PerClass
+  {
+    std::atomic<quint64> enqueued;
+    std::atomic<quint64> executed;
+    std::atomic<quint64> cancelledBeforeRun;
+    std::atomic<quint64> queued;
+    std::atomic<quint64> running;
+    LatencyHistogram queueWait;
+    LatencyHistogram runTime;
+  };
+
+  std::array<PerClass, JobClassCount> m_classes;
+  std::vector<std::unique_ptr<std::atomic<quint64> > > m_workerBusyNs;
+  std::atomic<ClockT::rep> m_startTime;
+
+  PerClass& get(JobClass jobClass)
+  {
+    return m_classes[static_cast<size_t>(jobClass)];
+  }
+};
+
+#endif // JOBMETRICS_H
@@ -0,0 +1,230 @@
+#include "./jobmetricsdialog.h"
+#include "./prioritythreadpool.h"
+#include "./regionfilereader.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QDateTime>
+#include <QFile>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QJsonArray>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+namespace {
+
+QString formatUs(double us)
+{
+  if (us >= 1e6)
+    return QString("%1s").arg(us * 1e-6, 0, 'f', 1);
+  if (us >= 1e3)
+    return QString("%1ms").arg(us * 1e-3, 0, 'f', 1);
+  return QString("%1us").arg(us, 0, 'f', 0);
+}
+
+QString formatHistogram(const LatencyHistogramSnapshot& histogram)
+{
+  return QString("mean %1 p50 <%2 p90 <%3 p99 <%4")
+      .arg(formatUs(histogram.meanUs()), 8)
+      .arg(formatUs(histogram.percentileUs(0.5)), 7)
+      .arg(formatUs(histogram.percentileUs(0.9)), 7)
+      .arg(formatUs(histogram.percentileUs(0.99)), 7);
+}
+
+}  // namespace
+
+JobMetricsDialog::JobMetricsDialog(const PoolListT& threadPools,
+                                   const StageStatsProviderT& stageStatsProvider,
+                                   QWidget *parent)
+  : QDialog(parent)
+  , m_threadPools(threadPools)
+  , m_stageStatsProvider(stageStatsProvider)
+  , m_text(new QPlainTextEdit)
+  , m_previous(getPoolMetrics())
+{
+  setWindowTitle(tr("Job Metrics"));
+
+  m_text->setReadOnly(true);
+  m_text->setLineWrapMode(QPlainTextEdit::NoWrap);
+  m_text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+  QPushButton *resetButton = new QPushButton(tr("Reset"));
+  QPushButton *copyButton = new QPushButton(tr("Copy JSON"));
+  QPushButton *saveButton = new QPushButton(tr("Save JSON..."));
+  QPushButton *closeButton = new QPushButton(tr("Close"));
+  connect(resetButton, SIGNAL(clicked()), this, SLOT(resetMetrics()));
+  connect(copyButton, SIGNAL(clicked()), this, SLOT(copyJson()));
+  connect(saveButton, SIGNAL(clicked()), this, SLOT(saveJson()));
+  connect(closeButton, SIGNAL(clicked()), this, SLOT(close()));
+
+  QHBoxLayout *buttons = new QHBoxLayout;
+  buttons->addWidget(resetButton);
+  buttons->addStretch(1);
+  buttons->addWidget(copyButton);
+  buttons->addWidget(saveButton);
+  buttons->addWidget(closeButton);
+
+  QVBoxLayout *layout = new QVBoxLayout;
+  layout->addWidget(m_text, 1);
+  layout->addLayout(buttons);
+  setLayout(layout);
+  resize(760, 480);
+
+  m_refreshTimer.setInterval(1000);
+  connect(&m_refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+QJsonDocument JobMetricsDialog::getMetricsAsJson() const
+{
+  QJsonArray stages;
+  if (m_stageStatsProvider)
+  {
+    for (const auto& stage: m_stageStatsProvider())
+    {
+      stages.append(stage.toJson());
+    }
+  }
+
+  QJsonArray pools;
+  for (const auto& pool: m_threadPools)
+  {
+    QJsonObject poolJson = pool.second->getMetrics().toJson();
+    poolJson["name"] = pool.first;
+    poolJson["threads"] = static_cast<double>(pool.second->getNumberOfThreads());
+    poolJson["activeThreadLimit"] = static_cast<double>(pool.second->getActiveThreadLimit());
+    pools.append(poolJson);
+  }
+
+  QJsonObject json;
+  json["application"] = qApp->applicationName();
+  json["version"] = qApp->applicationVersion();
+  json["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+  json["threadPools"] = pools;
+  json["pipelineStages"] = stages;
+  json["regionReads"] = RegionFileReader::getStats().toJson();
+  return QJsonDocument(json);
+}
+
+QVector<ThreadPoolMetricsSnapshot> JobMetricsDialog::getPoolMetrics() const
+{
+  QVector<ThreadPoolMetricsSnapshot> metrics;
+  for (const auto& pool: m_threadPools)
+  {
+    metrics.append(pool.second->getMetrics());
+  }
+  return metrics;
+}
+
+void JobMetricsDialog::showEvent(QShowEvent *event)
+{
+  QDialog::showEvent(event);
+  m_previous = getPoolMetrics();
+  refresh();
+  m_refreshTimer.start();
+}
+
+void JobMetricsDialog::hideEvent(QHideEvent *event)
+{
+  m_refreshTimer.stop();
+  QDialog::hideEvent(event);
+}
+
+void JobMetricsDialog::refresh()
+{
+  const QVector<ThreadPoolMetricsSnapshot> poolMetrics = getPoolMetrics();
+
+  QStringList lines;
+  for (int i = 0; i < m_threadPools.size(); i++)
+  {
+    const auto& pool = m_threadPools[i].second;
+    const ThreadPoolMetricsSnapshot& metrics = poolMetrics[i];
+
+    if (i > 0)
+      lines << "";
+    lines << QString("%1 pool: threads %2/%3, utilization %4% (last interval %5%), uptime %6s")
+             .arg(m_threadPools[i].first)
+             .arg(pool->getActiveThreadLimit())
+             .arg(pool->getNumberOfThreads())
+             .arg(metrics.utilization() * 100.0, 0, 'f', 1)
+             .arg(metrics.utilizationSince(m_previous.value(i, metrics)) * 100.0, 0, 'f', 1)
+             .arg(metrics.uptimeSeconds, 0, 'f', 0);
+
+    for (const auto& jobClass: metrics.jobClasses)
+    {
+      if (jobClass.enqueued == 0 && jobClass.queued == 0 && jobClass.running == 0)
+        continue;
+
+      lines << QString("%1 queued %2 running %3 executed %4 cancelled before run %5")
+               .arg(toString(jobClass.jobClass), -7)
+               .arg(jobClass.queued, 6)
+               .arg(jobClass.running, 3)
+               .arg(jobClass.executed, 9)
+               .arg(jobClass.cancelledBeforeRun, 9);
+      lines << QString("        queue wait %1").arg(formatHistogram(jobClass.queueWait));
+      lines << QString("        run time   %1").arg(formatHistogram(jobClass.runTime));
+    }
+  }
+
+  if (m_stageStatsProvider)
+  {
+    lines << "";
+    for (const auto& stage: m_stageStatsProvider())
+    {
+      lines << QString("%1 queued %2+%3/%4 running %5/%6 done %7 dropped %8 - %9/s")
+               .arg(stage.name, -10)
+               .arg(stage.queued).arg(stage.reserved).arg(stage.capacity)
+               .arg(stage.running).arg(stage.parallelism)
+               .arg(stage.processed).arg(stage.dropped)
+               .arg(stage.throughput, 0, 'f', 1);
+      lines << QString("           queue wait %1").arg(formatHistogram(stage.queueWait));
+    }
+  }
+
+  const RegionReadStats reads = RegionFileReader::getStats();
+  lines << "";
+  for (size_t i = 0; i < RegionReadModeCount; i++)
+  {
+    lines << QString("region reads %1 %2 MB in %3 chunks")
+             .arg(toString(static_cast<RegionReadMode>(i)), -13)
+             .arg(reads.bytes[i] / (1024.0 * 1024.0), 9, 'f', 1)
+             .arg(reads.chunks[i]);
+  }
+
+  m_text->setPlainText(lines.join("\n"));
+  m_previous = poolMetrics;
+}
+
+void JobMetricsDialog::resetMetrics()
+{
+  for (const auto& pool: m_threadPools)
+  {
+    pool.second->resetMetrics();
+  }
+  m_previous = getPoolMetrics();
+  refresh();
+}
+
+void JobMetricsDialog::copyJson()
+{
+  QApplication::clipboard()->setText(QString::fromUtf8(getMetricsAsJson().toJson()));
+}
+
+void JobMetricsDialog::saveJson()
+{
+  const QString filename = QFileDialog::getSaveFileName(this, tr("Save job metrics"),
+                                                        "metrics.json", tr("JSON (*.json)"));
+  if (filename.isEmpty())
+    return;
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    QMessageBox::warning(this, tr("Save job metrics"),
+                         tr("Could not write to %1").arg(filename));
+    return;
+  }
+  file.write(getMetricsAsJson().toJson());
+}
@@ -0,0 +1,56 @@
+#ifndef JOBMETRICSDIALOG_H
+#define JOBMETRICSDIALOG_H
+
+#include "jobmetrics.h"
+#include "pipelinestage.hpp"
+
+#include <QDialog>
+#include <QJsonDocument>
+#include <QList>
+#include <QPair>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+class QPlainTextEdit;
+class PriorityThreadPool;
+
+// Developer panel with the metrics of the thread pools and the processing pipelines.
+// The same numbers can be exported as JSON to compare tuning changes between builds.
+class JobMetricsDialog : public QDialog
+{
+  Q_OBJECT
+
+public:
+  typedef std::function<QVector<PipelineStageStats>()> StageStatsProviderT;
+  typedef QList<QPair<QString, QSharedPointer<PriorityThreadPool> > > PoolListT;
+
+  JobMetricsDialog(const PoolListT& threadPools,
+                   const StageStatsProviderT& stageStatsProvider,
+                   QWidget *parent = nullptr);
+
+  QJsonDocument getMetricsAsJson() const;
+
+protected:
+  void showEvent(QShowEvent *event) override;
+  void hideEvent(QHideEvent *event) override;
+
+private slots:
+  void refresh();
+  void resetMetrics();
+  void copyJson();
+  void saveJson();
+
+private:
+  PoolListT m_threadPools;
+  StageStatsProviderT m_stageStatsProvider;
+  QPlainTextEdit *m_text;
+  QTimer m_refreshTimer;
+  QVector<ThreadPoolMetricsSnapshot> m_previous;  // per pool, for the utilization of the last interval
+
+  QVector<ThreadPoolMetricsSnapshot> getPoolMetrics() const;
+};
+
+#endif // JOBMETRICSDIALOG_H
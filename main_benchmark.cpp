@@ -0,0 +1,339 @@
+#include "coordinateid.h"
+#include "flatcoordinatehashmap.hpp"
+#include "workstealingscheduler.hpp"
+#include "chunk.h"
+#include "chunkgbuffer.h"
+#include "chunkloader.h"
+#include "chunkrenderer.h"
+#include "definitionmanager.h"
+#include "rendersettings.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Micro benchmarks of the hot paths: coordinate hash maps, the work-stealing scheduler and the render kernels.
+// Every result is the time per operation, the checksums only keep the compiler from dropping the work.
+
+namespace {
+
+void printResult(const char* name, quint64 operations, qint64 nsecs)
+{
+  std::printf("%-48s %10.1f ns/op  (%llu ops)\n", name, double(nsecs) / operations,
+              static_cast<unsigned long long>(operations));
+}
+
+// ---- hash maps ----
+
+template<typename MapT>
+void benchmarkMap(const char* name, const std::vector<CoordinateID>& keys, int repetitions)
+{
+  QElapsedTimer timer;
+  qint64 insertTime = 0;
+  qint64 hitTime = 0;
+  qint64 missTime = 0;
+  quint64 checksum = 0;
+
+  for (int r = 0; r < repetitions; r++)
+  {
+    MapT map;
+
+    timer.start();
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      map[keys[i]] = static_cast<int>(i);
+    }
+    insertTime += timer.nsecsElapsed();
+
+    timer.start();
+    for (const auto& key: keys)
+    {
+      checksum += map.value(key, 0);
+    }
+    hitTime += timer.nsecsElapsed();
+
+    // same pattern shifted out of the filled area
+    timer.start();
+    for (const auto& key: keys)
+    {
+      checksum += map.value(CoordinateID(key.getX() + 100000, key.getZ()), 1);
+    }
+    missTime += timer.nsecsElapsed();
+  }
+
+  const quint64 operations = quint64(keys.size()) * repetitions;
+  std::printf("%s (checksum %llu)\n", name, static_cast<unsigned long long>(checksum));
+  printResult("  insert", operations, insertTime);
+  printResult("  lookup hit", operations, hitTime);
+  printResult("  lookup miss", operations, missTime);
+}
+
+void benchmarkMaps()
+{
+  // the chunks of a view: a square area, visited row by row
+  const int side = 512;
+  std::vector<CoordinateID> keys;
+  keys.reserve(side * side);
+  for (int z = -side / 2; z < side / 2; z++)
+  {
+    for (int x = -side / 2; x < side / 2; x++)
+    {
+      keys.push_back(CoordinateID(x, z));
+    }
+  }
+
+  benchmarkMap<QHash<CoordinateID, int>>("QHash<CoordinateID, int>", keys, 5);
+  benchmarkMap<FlatCoordinateHashMap<CoordinateID, int>>("FlatCoordinateHashMap<CoordinateID, int>", keys, 5);
+}
+
+// ---- scheduler ----
+
+// baseline: the single std::multimap behind one mutex that PriorityThreadPool used before the work-stealing scheduler
+template<typename T>
+class MutexPriorityQueue
+{
+public:
+  MutexPriorityQueue()
+    : m_alive(true)
+  {}
+
+  void registerCurrentThreadAsWorker(size_t)
+  {}
+
+  void push(T&& item, size_t prioClass)
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_queue.emplace(prioClass, std::move(item));
+    }
+    m_condition.notify_one();
+  }
+
+  bool pop(size_t, T& item)
+  {
+    std::unique_lock<std::mutex> guard(m_mutex);
+    while (m_queue.empty() && m_alive)
+    {
+      m_condition.wait(guard);
+    }
+    if (m_queue.empty())
+    {
+      return false;
+    }
+
+    const auto it = m_queue.begin();
+    item = std::move(it->second);
+    m_queue.erase(it);
+    return true;
+  }
+
+  void signalTerminate()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_alive = false;
+    }
+    m_condition.notify_all();
+  }
+
+private:
+  bool m_alive;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::multimap<size_t, T> m_queue;
+};
+
+enum class SchedulerMode
+{
+  Injected,  // pushed from outside, all workers pop
+  Local,     // every worker pushes its share to its own deque and pops
+  Stolen     // worker 0 pushes everything, the others steal
+};
+
+// nanoseconds per item
+template<typename SchedulerT>
+double runScheduler(SchedulerT& scheduler, SchedulerMode mode, size_t workers, size_t items)
+{
+  std::atomic<size_t> done(0);
+  std::atomic<size_t> checksum(0);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  std::vector<std::thread> threads;
+  for (size_t w = 0; w < workers; w++)
+  {
+    threads.emplace_back([&, w]() {
+      scheduler.registerCurrentThreadAsWorker(w);
+
+      if ((mode == SchedulerMode::Local) || ((mode == SchedulerMode::Stolen) && (w == 0)))
+      {
+        const size_t count = (mode == SchedulerMode::Local) ? items / workers : items;
+        for (size_t i = 0; i < count; i++)
+        {
+          scheduler.push(size_t(i), i & 1);
+        }
+      }
+
+      size_t item;
+      while (scheduler.pop(w, item))
+      {
+        checksum += item;
+        if (++done == items)
+        {
+          scheduler.signalTerminate();
+        }
+      }
+    });
+  }
+
+  if (mode == SchedulerMode::Injected)
+  {
+    for (size_t i = 0; i < items; i++)
+    {
+      scheduler.push(size_t(i), i & 1);
+    }
+  }
+
+  for (auto& thread: threads)
+  {
+    thread.join();
+  }
+  return double(timer.nsecsElapsed()) / items;
+}
+
+void benchmarkScheduler()
+{
+  const size_t maxWorkers = 64;
+  const size_t items = 1 << 19;  // divisible by every worker count
+
+  const SchedulerMode modes[] = {SchedulerMode::Injected, SchedulerMode::Local, SchedulerMode::Stolen};
+
+  std::printf("scheduler push/pop, ns per item (%zu items, %u hardware threads)\n", items,
+              std::thread::hardware_concurrency());
+  std::printf("%8s %12s %12s %12s %12s\n", "workers", "mutex queue", "injected", "local", "stolen");
+  for (size_t workers = 1; workers <= maxWorkers; workers *= 2)
+  {
+    std::printf("%8zu", workers);
+    {
+      // there is only one queue, the modes differ only in who pushes
+      MutexPriorityQueue<size_t> queue;
+      std::printf(" %12.1f", runScheduler(queue, SchedulerMode::Injected, workers, items));
+    }
+    for (SchedulerMode mode: modes)
+    {
+      WorkStealingScheduler<size_t> scheduler(workers);
+      std::printf(" %12.1f", runScheduler(scheduler, mode, workers, items));
+    }
+    std::printf("\n");
+  }
+}
+
+// ---- render kernels ----
+
+// every scan and shade kernel instantiation, for the flags the images depend on
+void benchmarkKernels(const QSharedPointer<Chunk>& chunk, int repetitions)
+{
+  const int imageFlags = RenderSettings::Lighting | RenderSettings::MobSpawn | RenderSettings::CaveMode |
+                         RenderSettings::DepthShading | RenderSettings::SingleLayer | RenderSettings::BiomeColors |
+                         RenderSettings::SeaGround;
+
+  std::vector<uchar> bits(16 * 16 * 4);
+  std::vector<uchar> depthbits(16 * 16);
+  QElapsedTimer timer;
+
+  std::printf("render kernels, 16x16 pixels per chunk\n");
+  for (int flags = 0; flags <= imageFlags; flags++)
+  {
+    if ((flags & ~imageFlags) != 0)
+    {
+      continue;
+    }
+
+    const RenderSettings settings(255, flags);
+    QSharedPointer<const ChunkGBuffer> gbuffer;
+
+    // scan and shade
+    timer.start();
+    for (int r = 0; r < repetitions; r++)
+    {
+      gbuffer.reset();
+      ChunkRenderer::renderChunk(settings, chunk, bits.data(), 16 * 4, depthbits.data(), 16, &gbuffer);
+    }
+    const qint64 scanTime = timer.nsecsElapsed();
+
+    // shade only, the G-buffer is still valid
+    timer.start();
+    for (int r = 0; r < repetitions; r++)
+    {
+      ChunkRenderer::renderChunk(settings, chunk, bits.data(), 16 * 4, depthbits.data(), 16, &gbuffer);
+    }
+    const qint64 shadeTime = timer.nsecsElapsed();
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "  flags 0x%02x scan+shade", flags);
+    printResult(name, repetitions, scanTime);
+    std::snprintf(name, sizeof(name), "  flags 0x%02x shade", flags);
+    printResult(name, repetitions, shadeTime);
+  }
+}
+
+void printUsage(const char* appname)
+{
+  std::cout << "usage " << appname << " [<leveldir> <pos_x> <pos_z>]" << std::endl;
+  std::cout << "  the render kernels are measured with the chunk at the block position of the world" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  QApplication app(argc, argv);
+  app.setApplicationName("Minutor");
+  app.setOrganizationName("seancode");
+
+  if ((argc != 1) && (argc != 4))
+  {
+    printUsage(argv[0]);
+    return -1;
+  }
+
+  benchmarkMaps();
+  benchmarkScheduler();
+
+  if (argc == 4)
+  {
+    bool ok_x = false;
+    bool ok_z = false;
+    const int x = QString(argv[2]).toInt(&ok_x);
+    const int z = QString(argv[3]).toInt(&ok_z);
+    if (!ok_x || !ok_z)
+    {
+      printUsage(argv[0]);
+      return -1;
+    }
+
+    DefinitionManager dm;  // loads the block definitions
+
+    ChunkLoader loader(argv[1], ChunkID::fromCoordinates(x, z));
+    const QSharedPointer<Chunk> chunk = loader.runInternal();
+    if (!chunk)
+    {
+      std::cout << "no chunk at " << x << "," << z << std::endl;
+      return -1;
+    }
+
+    benchmarkKernels(chunk, 2000);
+  }
+
+  return 0;
+}
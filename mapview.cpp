@@ -3,10 +3,12 @@
 #include "./mapview.h"
 #include "./chunkcache.h"
 #include "./chunkrenderer.h"
+#include "./chunkgbuffer.h"
 #include "./definitionmanager.h"
 #include "./blockidentifier.h"
 #include "./biomeidentifier.h"
 #include "./clamp.h"
+#include "./regionfilereader.h"
 #include "./chunkrenderer.h"
 #include "prioritythreadpool.h"
 
@@ -14,11 +16,58 @@
 #include <QRunnable>
 #include <QPainter>
 #include <QResizeEvent>
+#include <QRegion>
 #include <QMessageBox>
+#include <QDirIterator>
 #include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 static const double overscanZoomFactor = 0.8;
 
+// chunk groups requested at once for the tile pyramid, their G-buffers are kept until they are complete
+static const int maxPyramidGroupsInFlight = 64;
+
+// pixels entities and structures may reach beyond their chunk group, redrawn with it
+static const int overlayMargin = 32;
+
+// moves the content of a 32 bit image by whole pixels, the exposed pixels keep their old content
+static void scrollImage(QImage& image, int dx, int dy)
+{
+  const int width = image.width() - std::abs(dx);
+  const int height = image.height() - std::abs(dy);
+  if ((width <= 0) || (height <= 0))
+  {
+    return;
+  }
+
+  const int srcX = std::max(0, -dx);
+  const int dstX = std::max(0, dx);
+  for (int i = 0; i < height; i++)
+  {
+    // rows are copied away from the direction of the move, the source rows are still unchanged
+    const int row = (dy > 0) ? (height - 1 - i) : i;
+    const int srcY = row + std::max(0, -dy);
+    const int dstY = row + std::max(0, dy);
+    memmove(image.scanLine(dstY) + dstX * 4, image.constScanLine(srcY) + srcX * 4, width * 4);
+  }
+}
+
+// sets all pixels of a 32 bit image in the region
+static void fillRegion(QImage& image, const QRegion& region, quint32 value)
+{
+  for (const QRect& rect: region)
+  {
+    const QRect clipped = rect & image.rect();
+    for (int y = clipped.top(); y <= clipped.bottom(); y++)
+    {
+      quint32 *line = reinterpret_cast<quint32*>(image.scanLine(y)) + clipped.left();
+      std::fill(line, line + clipped.width(), value);
+    }
+  }
+}
+
 class DrawHelper
 {
 public:
@@ -71,9 +120,6 @@ public:
       canvas.setRenderHint(QPainter::SmoothPixmapTransform);
   }
 
-  void drawChunk_Map(int x, int z, const QSharedPointer<RenderedChunk> &renderedChunk);
-  void drawChunk_Map_int(int x, int z, const QImage& renderedChunk);
-
   QPainter& getCanvas() { return canvas; }
 
 protected:
@@ -100,6 +146,14 @@ public:
 
   void drawEntityMap(const Chunk::EntityMap& map, const ChunkGroupID &cgID, const RenderGroupData &depthImg, const QSet<QString> &overlayItemTypes, const int depth, const double zoom);
 
+  // all layers are only drawn in the region
+  void setClipRegion(const QRegion& region)
+  {
+    canvas.setClipRegion(region);
+    canvas_entities.setClipRegion(region);
+    canvas_players.setClipRegion(region);
+  }
+
   void drawOverlayItemToPlayersCanvas(const QVector<QSharedPointer<OverlayItem> >& items)
   {
     for (const auto& item: items)
@@ -155,53 +209,100 @@ public:
   int count() const { return chunkGroupsWide * chunkGroupsTall;  }
 };
 
-class ChunkGroupRendererC: public ChunkGroupCamC
-{
-public:
-  ChunkGroupRendererC(RenderGroupData& data_, const ChunkGroupID cgid_)
-    : ChunkGroupCamC(data_.init(), cgid_)
-    , ncdata(data_)
-    , h(cam.centerpos_blocks.x, cam.centerpos_blocks.z,
-        cam.zoom, cam.size_pixels)
-    , image(ncdata.renderedImg)
-    , imageDepth(ncdata.depthImg)
-    , h2(h, image)
-    , h2_depth(h, imageDepth)
-  {
-  }
-
-  void drawChunk(const ChunkID cid, const QSharedPointer<RenderedChunk>& renderedChunk)
-  {
-    h2.drawChunk_Map(cid.getX(), cid.getZ(), renderedChunk); // can deal with nullptr!
-
-    if (renderedChunk)
-    {
-      ncdata.entities[cid] = renderedChunk->entities;
-
-      h2_depth.drawChunk_Map_int(cid.getX(), cid.getZ(), renderedChunk->depth);
-    }
-  }
-
-private:
-  RenderGroupData& ncdata;
-  const DrawHelper h;
-  QImage& image;
-  QImage& imageDepth;
-  DrawHelper2 h2;
-  DrawHelper2 h2_depth;
-};
-
 MapView::MapView(const QSharedPointer<PriorityThreadPool> &threadpool,
                  const QSharedPointer<ChunkCache>& chunkcache,
                  QWidget *parent)
   : QWidget(parent)
+  , m_viewportMeasurementPending(false)
+  , m_lastViewportCompleteTime(0)
+  , m_previewing(false)
   , zoom(1.0)
   , updateTimer()
   , cache(chunkcache)
   , renderedChunkGroupsCache(std::make_unique<RenderedChunkGroupCacheUnprotectedT>("rendergroups"))
+  , m_displayDepthMap(false)
+  , m_chunkGroupStatus(false)
+  , m_chunkCacheStatus(false)
+  , m_pyramidTilesChanged(false)
   , dragging(false)
   , m_asyncRendererPool(threadpool)
   , cancellationGuard()
+  , m_redrawCheckPending(true)
+  , m_renderStage("render", threadpool, PriorityThreadPool::JobPrio::high, JobClass::render, cancellationGuard, [this](RenderItem& item) {
+      // the settings when the job runs, not when it was queued
+      renderingStarted(item);
+      ChunkRenderer::renderGroup(getRenderSettings(), item.chunks, *item.group);
+      for (auto& chunkItem: item.chunks)
+      {
+        chunkItem.chunk.reset();
+      }
+      return true;
+    })
+  , m_compositeStage("composite", threadpool, PriorityThreadPool::JobPrio::high, JobClass::render, cancellationGuard, [this](RenderItem& item) {
+      for (const auto& chunkItem: item.chunks)
+      {
+        renderingDone(chunkItem.rendered, item.group);
+      }
+      return true;
+    })
+  , m_pyramidStage("pyramid", threadpool, PriorityThreadPool::JobPrio::low, JobClass::render, cancellationGuard, [this](PyramidItem& item) {
+      QImage image;
+      QImage depthImage;
+      {
+        QMutexLocker locker(&item.group->imageMutex);  // render jobs write into the image
+        image = item.group->renderedImg.copy();
+        if (item.store)
+        {
+          depthImage = item.group->depthImg.copy();
+        }
+      }
+      m_pyramid.update(item.cgid, image, item.complete, item.params);
+      m_pyramidTilesChanged = true;
+      if (item.store)
+      {
+        item.store->saveGroup(item.params, item.cgid, TileStore::GroupTile{image, depthImage, item.params.lod, item.timestamp});
+      }
+      item.group.reset();
+      return true;
+    })
+  , m_storeLoadStage("tileload", threadpool, PriorityThreadPool::JobPrio::high, JobClass::load, cancellationGuard, [](StoreItem& item) {
+      item.found = item.store->loadGroup(item.params, item.cgid, item.tile);
+      return true;
+    })
+  , m_storeApplyStage("tileapply", threadpool, PriorityThreadPool::JobPrio::high, JobClass::load, cancellationGuard, [this](StoreItem& item) {
+      applyStoredGroup(item);
+      return true;
+    })
+  , m_pyramidLoadStage("pyramidload", threadpool, PriorityThreadPool::JobPrio::high, JobClass::load, cancellationGuard, [](PyramidStoreItem& item) {
+      loadPyramidTiles(item);
+      return true;
+    })
+  , m_pyramidApplyStage("pyramidapply", threadpool, PriorityThreadPool::JobPrio::high, JobClass::load, cancellationGuard, [this](PyramidStoreItem& item) {
+      const RenderParams params = m_pyramid.getParams();
+      if ((item.store != m_tileStore) || (item.params.renderedAt != params.renderedAt) ||
+          (item.params.renderedFlags != params.renderedFlags))
+      {
+        return true;  // another world or other settings in the meantime
+      }
+      for (const auto& tile: item.tiles)
+      {
+        m_pyramid.insertTile(tile.level, tile.id, tile.image);
+      }
+      m_pyramidTilesChanged = true;
+      return true;
+    })
+  , m_pyramidSaveStage("pyramidsave", threadpool, PriorityThreadPool::JobPrio::low, JobClass::load, cancellationGuard, [](PyramidStoreItem& item) {
+      savePyramidTiles(item);
+      return true;
+    })
+  , m_framePool(QSharedPointer<PriorityThreadPool>::create(1))
+  , m_frameStage("frame", m_framePool, PriorityThreadPool::JobPrio::high, JobClass::render, cancellationGuard, [this](FrameItem& item) {
+      const QRegion changed = composeFrame(item);
+      QMetaObject::invokeMethod(this, "frameComposited", Qt::QueuedConnection, Q_ARG(QRegion, changed));
+      return true;
+    })
+  , m_frameInFlight(false)
+  , m_renderEpoch(0)
 {
   havePendingToolTip = false;
 
@@ -211,14 +312,20 @@ MapView::MapView(const QSharedPointer<PriorityThreadPool> &threadpool,
   updateTimer.setInterval(30);
   updateTimer.start();
 
+  m_viewportTimer.start();
+
   depth = 255;
+  flags = 0;
+  lod = 1;
   scale = 1;
+  m_pyramid.clear(getCurrentRenderParams());
   connect(cache.data(), SIGNAL(structureFound(QSharedPointer<GeneratedStructure>)),
           this,   SLOT  (addStructureFromChunk(QSharedPointer<GeneratedStructure>)));
   setMouseTracking(true);
   setFocusPolicy(Qt::StrongFocus);
 
   getPlaceholder(); // force init
+  reloadSettings();
 
   // calculate exponential function for cave shade
   float cavesum = 0.0;
@@ -231,11 +338,39 @@ MapView::MapView(const QSharedPointer<PriorityThreadPool> &threadpool,
   }
 
   qRegisterMetaType<QSharedPointer<RenderedChunk> >("QSharedPointer<RenderedChunk>");
+
+  const size_t cores = threadpool->getNumberOfThreads();
+  m_renderStage.configure(4 * cores, cores);
+  m_compositeStage.configure(256 * cores, 0);  // processed by regularUpdate()
+  m_pyramidStage.configure(256, 1);  // in the background, the view shows the chunk groups meanwhile
+  m_storeLoadStage.configure(4 * cores, cores);
+  m_storeApplyStage.configure(256 * cores, 0);  // processed by regularUpdate()
+  m_pyramidLoadStage.configure(2, 1);
+  m_pyramidApplyStage.configure(2, 0);  // processed by regularUpdate()
+  m_pyramidSaveStage.configure(64, 1);  // not cleared, the tiles of every world and settings are written
+  m_frameStage.configure(1, 1);  // one frame at a time, see redraw__changed()
+
+  m_renderStage.setPriority([this](const RenderItem& item) {
+    // all chunks of a job are in the same group
+    const auto& rendered = item.chunks.front().rendered;
+    return getChunkPriority(ChunkID(rendered->chunkX, rendered->chunkZ));
+  }, [this](RenderItem& item) {
+    for (const auto& chunkItem: item.chunks)
+    {
+      QMetaObject::invokeMethod(this, "renderingDropped", Q_ARG(ChunkID, ChunkID(chunkItem.rendered->chunkX, chunkItem.rendered->chunkZ)));
+    }
+  });
+
+  m_renderStage.connectTo(m_compositeStage);
+  m_storeLoadStage.connectTo(m_storeApplyStage);
+  m_pyramidLoadStage.connectTo(m_pyramidApplyStage);
 }
 
 MapView::~MapView()
 {
-
+  saveStoredPyramid();
+  m_pyramidSaveStage.waitForDone();
+  cancellationGuard.cancelAndWait();  // render jobs access members
 }
 
 QSize MapView::minimumSizeHint() const {
@@ -255,6 +390,18 @@ void MapView::attach(QSharedPointer<ChunkCache> chunkCache_)
 
   connect(cache.data(), SIGNAL(chunkLoaded(const QSharedPointer<Chunk>&, int, int)),
           this, SLOT(chunkUpdated(const QSharedPointer<Chunk>&, int, int)));
+  connect(cache.data(), SIGNAL(chunkLoadingDropped(int, int)),
+          this, SLOT(chunkLoadingDropped(int, int)));
+
+  // the cache may outlive this view -> weak token
+  cache->setLoadPriorityProvider([this, weakToken = cancellationGuard.getToken().toWeakToken()](const ChunkID& cid) {
+    const auto token = weakToken.lock();  // keeps this view alive during evaluation
+    if (!token || token->isCanceled())
+    {
+      return 0.0;
+    }
+    return getChunkPriority(cid);
+  });
 }
 
 void MapView::setLocation(double x, double z) {
@@ -298,16 +445,36 @@ void MapView::setDimension(QString path, int scale) {
     this->x = 0;  // and we jump to the center spawn automatically
     this->z = 0;
   }
-  clearCache();
   cache->setPath(path);
+  clearCache();
 }
 
 void MapView::setDepth(int depth) {
-  this->depth = depth;
+  const bool changed = (this->depth != depth);
+  if (changed) {
+    cancelPendingRendering();
+    m_settingsTimer.start();
+  }
+  {
+    QWriteLocker locker(&m_readWriteLock);
+    this->depth = depth;
+    m_previewing = m_previewing || changed;
+  }
+  updatePyramidSettings();
 }
 
 void MapView::setFlags(int flags) {
-  this->flags = flags;
+  const bool changed = (this->flags != flags);
+  if (changed) {
+    cancelPendingRendering();
+    m_settingsTimer.start();
+  }
+  {
+    QWriteLocker locker(&m_readWriteLock);
+    this->flags = flags;
+    m_previewing = m_previewing || changed;
+  }
+  updatePyramidSettings();
 }
 
 int MapView::getFlags() const {
@@ -318,6 +485,11 @@ int MapView::getDepth() const {
   return depth;
 }
 
+RenderSettings MapView::getRenderSettings() const {
+  QReadLocker locker(&m_readWriteLock);
+  return RenderSettings(depth, flags, lod, getPreviewLod());
+}
+
 void MapView::chunkUpdated(const QSharedPointer<Chunk>& chunk, int x, int z)
 {
   const ChunkID cid(x, z);
@@ -325,6 +497,7 @@ void MapView::chunkUpdated(const QSharedPointer<Chunk>& chunk, int x, int z)
 
   if (!chunk)
   {
+    markChunkNonExisting(cid);
     return;
   }
 
@@ -354,23 +527,152 @@ QString MapView::getWorldPath() {
 
 void MapView::updatePlayerPositions(const QVector<PlayerInfo> &playerList)
 {
+  damageOverlayItems(currentPlayers);
   currentPlayers.clear();
   for (auto info: playerList)
   {
     auto entity = QSharedPointer<Entity>::create(info);
     currentPlayers.push_back(entity);
   }
+  damageOverlayItems(currentPlayers);
 }
 
 void MapView::updateSearchResultPositions(const QVector<QSharedPointer<OverlayItem>> &searchResults)
 {
+  damageOverlayItems(currentSearchResults);
   currentSearchResults = searchResults;
+  damageOverlayItems(currentSearchResults);
+}
+
+// the old and new places of moved items are drawn again with the next frame
+void MapView::damageOverlayItems(const QVector<QSharedPointer<OverlayItem>>& items)
+{
+  for (const auto& item: items)
+  {
+    if (item)
+    {
+      OverlayItem::Point min;
+      OverlayItem::Point max;
+      item->getBounds(min, max);
+      m_overlayDamage.append(QRectF(QPointF(min.x, min.z), QPointF(max.x, max.z)));
+    }
+  }
+}
+
+void MapView::reloadSettings()
+{
+  QSettings settings;
+  m_displayDepthMap = settings.value("depthmapview", false).toBool();
+  m_chunkGroupStatus = settings.value("chunkgroupstatus", false).toBool();
+  m_chunkCacheStatus = settings.value("chunkcachestatus", false).toBool();
+  m_composited.valid = false;
 }
 
 void MapView::clearCache() {
-  chunksToRedraw.clear();
+  cancelPendingRendering();
+  m_compositeStage.clear();
   cache->clear();
   renderedChunkGroupsCache.lock()().clear();
+  m_pyramidStage.clear();
+  m_storeLoadStage.clear();
+  m_storeApplyStage.clear();
+  m_pyramidLoadStage.clear();
+  m_pyramidApplyStage.clear();
+  m_pyramidDirty.clear();
+  saveStoredPyramid();  // of the world shown so far
+  m_pyramid.clear(getCurrentRenderParams());
+  openWorld();
+  m_composited.valid = false;
+  m_redrawCheckPending = true;
+}
+
+void MapView::openWorld()
+{
+  const bool useTileStore = QSettings().value("tilestore", true).toBool();
+  m_tileStore = (useTileStore && !cache->getPath().isEmpty())
+      ? QSharedPointer<TileStore>::create(cache->getPath())
+      : QSharedPointer<TileStore>();
+
+  findWorldGroups();
+  loadStoredPyramid();
+}
+
+void MapView::findWorldGroups()
+{
+  m_worldGroups.clear();
+  m_groupTimestamps.clear();
+
+  // a region file has 32x32 chunks
+  const int groupsPerRegion = 32 / ChunkGroupID::SIZE_N;
+
+  QDirIterator it(cache->getPath() + "/region", QStringList() << "r.*.*.mca");
+  while (it.hasNext()) {
+    it.next();
+    const QStringList parts = it.fileName().split('.');
+    bool validX = false;
+    bool validZ = false;
+    const int rx = parts.value(1).toInt(&validX);
+    const int rz = parts.value(2).toInt(&validZ);
+    if ((parts.size() != 4) || !validX || !validZ) {
+      continue;
+    }
+
+    // stored tiles are stale when a chunk was saved after them, only the header of the region is read
+    const QVector<quint32> timestamps = m_tileStore ? RegionFileReader::readTimestamps(it.filePath())
+                                                    : QVector<quint32>();
+
+    for (int gz = 0; gz < groupsPerRegion; gz++) {
+      for (int gx = 0; gx < groupsPerRegion; gx++) {
+        const ChunkGroupID cgid(rx * groupsPerRegion + gx, rz * groupsPerRegion + gz);
+        m_worldGroups.append(cgid);
+
+        quint32 newest = std::numeric_limits<quint32>::max();  // unknown: never up to date
+        if (!timestamps.isEmpty()) {
+          newest = 0;
+          for (int cz = 0; cz < ChunkGroupID::SIZE_N; cz++) {
+            for (int cx = 0; cx < ChunkGroupID::SIZE_N; cx++) {
+              const int index = (gx * ChunkGroupID::SIZE_N + cx) + (gz * ChunkGroupID::SIZE_N + cz) * 32;
+              newest = std::max(newest, timestamps[index]);
+            }
+          }
+        }
+        m_groupTimestamps.insert(cgid, newest);
+      }
+    }
+  }
+
+  std::sort(m_worldGroups.begin(), m_worldGroups.end(), worldGroupBefore);
+}
+
+bool MapView::worldGroupBefore(const ChunkGroupID& a, const ChunkGroupID& b)
+{
+  return (a.getZ() < b.getZ()) || ((a.getZ() == b.getZ()) && (a.getX() < b.getX()));
+}
+
+template<typename FunctionT>
+bool MapView::forEachWorldGroupIn(const QRect& chunkGroups, const FunctionT& function) const
+{
+  if (m_worldGroups.isEmpty())
+  {
+    return true;
+  }
+
+  // only the rows of the rectangle the world has groups in, each one found with a binary search
+  const int top = std::max(chunkGroups.top(), m_worldGroups.first().getZ());
+  const int bottom = std::min(chunkGroups.bottom(), m_worldGroups.last().getZ());
+  for (int gz = top; gz <= bottom; gz++)
+  {
+    auto it = std::lower_bound(m_worldGroups.begin(), m_worldGroups.end(), ChunkGroupID(chunkGroups.left(), gz),
+                               worldGroupBefore);
+    for (; (it != m_worldGroups.end()) && (it->getZ() == gz) && (it->getX() <= chunkGroups.right()); ++it)
+    {
+      if (!function(*it))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
 }
 
 void MapView::mousePressEvent(QMouseEvent *event) {
@@ -406,7 +708,8 @@ void MapView::adjustZoom(double steps)
 {
   const bool allowZoomOut = QSettings().value("zoomout", false).toBool();
 
-  const double zoomMin = allowZoomOut ? 0.05 : 1.0;
+  // zoomed out as far as one pixel per region, see TilePyramid::MaxLevel
+  const double zoomMin = allowZoomOut ? 1.0 / (1 << TilePyramid::MaxLevel) : 1.0;
   const double zoomMax = 20.0;
 
   const bool useFineZoomStrategy = QSettings().value("finezoom", false).toBool();
@@ -420,6 +723,16 @@ void MapView::adjustZoom(double steps)
 
   if (zoom < zoomMin) zoom = zoomMin;
   if (zoom > zoomMax) zoom = zoomMax;
+
+  // zoomed out the chunks are rendered with fewer columns instead of scaling down every block
+  const int newLod = RenderSettings::lodForZoom(zoom);
+  if (newLod != lod) {
+    cancelPendingRendering();
+    QWriteLocker locker(&m_readWriteLock);
+    lod = newLod;
+  }
+
+  update();  // the latest frame scaled, see paintEvent()
 }
 
 const QImage& getPlaceholder()
@@ -474,26 +787,185 @@ const QImage& getChunkGroupPlaceholder()
   return img;
 }
 
-size_t MapView::renderChunkAsync(const QSharedPointer<Chunk> &chunk)
+void MapView::cancelPendingRendering()
+{
+  // O(1) for the queued jobs, chunks still marked as requested are requested again with the next update
+  chunksToRedraw.clear();
+  m_renderStage.clear();
+  m_renderEpoch++;
+}
+
+ChunkRenderer::GroupItem MapView::createRenderItem(const QSharedPointer<Chunk> &chunk)
+{
+  ChunkRenderer::GroupItem item;
+  item.chunk = chunk;
+  item.rendered = QSharedPointer<RenderedChunk>::create(chunk);
+  item.rendered->westEdge = getEastEdge(renderedChunkGroupsCache.lock()(), ChunkID(chunk->getChunkX() - 1, chunk->getChunkZ()), lod);
+  return item;
+}
+
+bool MapView::getShadingOnlyItem(const ChunkID& cid, ChunkRenderer::GroupItem& item)
 {
-  auto renderedChunk = QSharedPointer<RenderedChunk>::create(chunk);
-  renderedChunk->init();
+  const auto cgID = ChunkGroupID::fromCoordinates(cid.getX(), cid.getZ());
+
+  auto cgLock = renderedChunkGroupsCache.lock();
+  auto grData = cgLock()[cgID];
+  if (!grData)
+  {
+    return false;
+  }
+
+  const auto gbuffer = grData->gbuffers.value(cid);
+  if (!gbuffer || !gbuffer->isValidFor(depth, ChunkRenderer::getScanFlags(flags), lod))
+  {
+    return false;
+  }
+
+  // without chunk the G-buffer is shaded only
+  item.rendered = QSharedPointer<RenderedChunk>::create(cid.getX(), cid.getZ(), grData->entities.value(cid), gbuffer);
+  item.rendered->westEdge = getEastEdge(cgLock(), ChunkID(cid.getX() - 1, cid.getZ()), lod);
+  return true;
+}
+
+ChunkEdgeHeights MapView::getEastEdge(RenderedChunkGroupCacheUnprotectedT& groups, const ChunkID& cid, int lod)
+{
+  const auto grData = groups[ChunkGroupID::fromCoordinates(cid.getX(), cid.getZ())];
+  const RenderGroupData::ChunkState *state = grData ? grData->states.find(cid) : nullptr;
+  return (state && (state->renderedFor.lod == lod)) ? state->eastEdge : unknownEdgeHeights();
+}
+
+void MapView::checkEdge(RenderedChunkGroupCacheUnprotectedT& groups, const ChunkID& westCid, const ChunkID& eastCid)
+{
+  const auto westData = groups[ChunkGroupID::fromCoordinates(westCid.getX(), westCid.getZ())];
+  const auto eastData = groups[ChunkGroupID::fromCoordinates(eastCid.getX(), eastCid.getZ())];
+  if (!westData || !eastData)
+  {
+    return;
+  }
+
+  const RenderGroupData::ChunkState *westState = westData->states.find(westCid);
+  RenderGroupData::ChunkState *eastState = eastData->states.find(eastCid);
+  if (!westState || !eastState || (eastState->renderedFor.renderedAt < 0) || !eastData->gbuffers.contains(eastCid))
+  {
+    return;
+  }
+
+  // shaded with an edge that changed since: shade again, the G-buffer is kept
+  if (eastState->westEdge != westState->eastEdge)
+  {
+    eastState->renderedFor.invalidate();
+    eastData->renderedFor.invalidate();
+  }
+}
+
+double MapView::getChunkPriority(const ChunkID& cid)
+{
+  QReadLocker locker(&m_readWriteLock);
+
+  if (!m_priorityRegion.valid)
+  {
+    return 0.0;
+  }
+
+  const ChunkGroupID cgid = ChunkGroupID::fromCoordinates(cid.getX(), cid.getZ());
+  if (!m_priorityRegion.chunkGroups.contains(cgid.getX(), cgid.getZ()))
+  {
+    return -1.0; // scrolled out of view -> obsolete
+  }
+
+  const double dx = (cid.getX() * ChunkID::SIZE_N + ChunkID::SIZE_N / 2) - m_priorityRegion.center.x;
+  const double dz = (cid.getZ() * ChunkID::SIZE_N + ChunkID::SIZE_N / 2) - m_priorityRegion.center.z;
+  return dx * dx + dz * dz;
+}
+
+void MapView::updatePriorityRegion()
+{
+  DrawHelper h(x, z, zoom * overscanZoomFactor, size());
+  ChunkGroupDrawRegion region(h.cam);
+
+  PriorityRegion newRegion;
+  newRegion.center = h.cam.centerpos_blocks;
+  newRegion.chunkGroups = region.getRect().adjusted(-1, -1, 1, 1);  // margin to keep jobs at the border on small movements
+  newRegion.valid = true;
+
+  // only written by this thread, no lock needed for reading
+  if (m_priorityRegion.valid &&
+      (m_priorityRegion.center.x == newRegion.center.x) &&
+      (m_priorityRegion.center.z == newRegion.center.z) &&
+      (m_priorityRegion.chunkGroups == newRegion.chunkGroups))
+  {
+    return;
+  }
+
+  {
+    QWriteLocker locker(&m_readWriteLock);
+    m_priorityRegion = newRegion;
+  }
+
+  m_asyncRendererPool->reevaluatePriorities();
+
+  m_viewportTimer.restart();
+  m_viewportMeasurementPending = true;
+}
+
+void MapView::checkViewportComplete()
+{
+  if (!m_viewportMeasurementPending || !chunksToRedraw.isEmpty())
+  {
+    return;
+  }
+
+  const RenderParams current = getCurrentRenderParams();
+  DrawHelper h(x, z, zoom, size());
+  ChunkGroupDrawRegion region(h.cam);
+
+  if (isPyramidZoom())
+  {
+    const bool complete = forEachWorldGroupIn(region.getRect(), [&](const ChunkGroupID& cgid) {
+      return m_pyramid.isComplete(cgid, current);
+    });
+    if (!complete)
+    {
+      return;
+    }
 
-  return m_asyncRendererPool->enqueueJob([this, chunk, renderedChunk, cancelToken = cancellationGuard.getToken()](){
-    if (cancelToken.isCanceled())
+    m_viewportMeasurementPending = false;
+    m_lastViewportCompleteTime = m_viewportTimer.elapsed();
+    return;
+  }
+
+  auto lock = renderedChunkGroupsCache.lock();
+
+  for (auto point: region)
+  {
+    const ChunkGroupID cgid(point.getX(), point.getZ());
+    const auto data = lock()[cgid];
+    if (!data || (data->renderedFor != current))
+    {
       return;
+    }
 
-    ChunkRenderer::renderChunk(*this, chunk, *renderedChunk);
-    QMetaObject::invokeMethod(this, "renderingDone", Q_ARG(QSharedPointer<RenderedChunk>, renderedChunk));
-  }, PriorityThreadPool::JobPrio::high);
+    for (auto coordinate: cgid)
+    {
+      const auto state = data->states.find(ChunkID(coordinate.getX(), coordinate.getZ()));
+      if (state && isRenderingRequested(*state))
+      {
+        return;
+      }
+    }
+  }
+
+  m_viewportMeasurementPending = false;
+  m_lastViewportCompleteTime = m_viewportTimer.elapsed();
 }
 
 void MapView::updateCacheSize(bool onlyIncrease)
 {
-  DrawHelper h(x, z, zoom * overscanZoomFactor, imageChunks.size());
+  DrawHelper h(x, z, zoom * overscanZoomFactor, size());
   ChunkGroupDrawRegion region(h.cam);
 
-  const int newCount = region.count() * 3;
+  // in the tile pyramid only the groups being rendered are kept
+  const int newCount = isPyramidZoom() ? maxPyramidGroupsInFlight * 2 : region.count() * 3;
 
   auto lock = renderedChunkGroupsCache.lock();
 
@@ -502,10 +974,35 @@ void MapView::updateCacheSize(bool onlyIncrease)
     return;
   }
 
+  if (newCount < lock().maxCost())
+  {
+    m_redrawCheckPending = true;  // groups might be evicted
+  }
   lock().setMaxCost(newCount);
 }
 
-void MapView::renderingDone(const QSharedPointer<RenderedChunk> renderedChunk)
+void MapView::renderingStarted(const RenderItem& item)
+{
+  // the pixels are written before it is known whether the job is cancelled: until renderingDone() sets
+  // the new state the chunks are invalid, so a cancelled job's chunks are requested again
+  auto cgLock = renderedChunkGroupsCache.lock();
+  for (const auto& chunkItem: item.chunks)
+  {
+    auto state = item.group->states.find(ChunkID(chunkItem.rendered->chunkX, chunkItem.rendered->chunkZ));
+    if (state)
+    {
+      state->renderedFor.invalidate();
+    }
+  }
+  item.group->renderedFor.invalidate();
+  if (item.group->storeState == RenderGroupData::StoreState::Saved)
+  {
+    item.group->storeState = RenderGroupData::StoreState::Loaded;
+  }
+}
+
+void MapView::renderingDone(const QSharedPointer<RenderedChunk> renderedChunk,
+                            const QSharedPointer<RenderGroupData> group)
 {
   if (!renderedChunk)
   {
@@ -517,124 +1014,507 @@ void MapView::renderingDone(const QSharedPointer<RenderedChunk> renderedChunk)
   const auto cgID = ChunkGroupID::fromCoordinates(id.getX(), id.getZ());
   {
     auto cgLock = renderedChunkGroupsCache.lock();
-    auto grData = cgLock().findOrCreate(cgID);
+    auto grData = cgLock()[cgID];
+
+    // the pixels are already written, a group evicted in the meantime requests the chunk again
+    if (grData && (grData == group))
+    {
+      grData->entities[id] = renderedChunk->entities;
+      grData->gbuffers[id] = renderedChunk->gbuffer;
+
+      auto& state = grData->states[id];
+      state.flags.unset(RenderStateT::RenderingRequested);
+      state.renderedFor = renderedChunk->renderedFor;
+      state.westEdge = renderedChunk->westEdge;
+      state.eastEdge = renderedChunk->eastEdge;
+
+      grData->renderedFor.invalidate();
+      if (grData->storeState == RenderGroupData::StoreState::Saved)
+      {
+        grData->storeState = RenderGroupData::StoreState::Loaded;  // saved again once complete
+      }
+      m_pyramidDirty.insert(cgID);
+      m_redrawGroups.insert(cgID);
+      m_redrawCheckPending = true;
+
+      // the relief shading continues across chunk borders, a neighbor rendered in the meantime might not match
+      checkEdge(cgLock(), ChunkID(id.getX() - 1, id.getZ()), id);
+      checkEdge(cgLock(), id, ChunkID(id.getX() + 1, id.getZ()));
+    }
+  }
+}
+
+void MapView::renderingDropped(ChunkID cid)
+{
+  const auto cgID = ChunkGroupID::fromCoordinates(cid.getX(), cid.getZ());
+
+  auto cgLock = renderedChunkGroupsCache.lock();
+  auto grData = cgLock()[cgID];
+  if (grData)
+  {
+    // request again, when it becomes visible again
+    grData->states[cid].flags.unset(RenderStateT::RenderingRequested);
+    grData->renderedFor.invalidate();
+    m_redrawCheckPending = true;
+  }
+}
+
+void MapView::chunkLoadingDropped(int x, int z)
+{
+  renderingDropped(ChunkID(x, z));
+}
+
+void MapView::markChunkNonExisting(const ChunkID& cid)
+{
+  const auto cgID = ChunkGroupID::fromCoordinates(cid.getX(), cid.getZ());
+
+  auto cgLock = renderedChunkGroupsCache.lock();
+  auto grData = cgLock()[cgID];
+  if (grData)
+  {
+    // nothing to render, keep the placeholder until render parameters change
+    auto& state = grData->states[cid];
+    state.flags.unset(RenderStateT::RenderingRequested);
+    state.renderedFor = getCurrentRenderParams();
+    m_pyramidDirty.insert(cgID);  // might have been the last chunk of the group
+    m_redrawGroups.insert(cgID);
+  }
+}
+
+void MapView::regularUpdate()
+{
+  if (!this->isEnabled()) {
+    return;
+  }
+
+  updateCacheSize(true);
+
+  // depth and flags rest: the previews are refined
+  if (m_previewing && m_settingsTimer.hasExpired(previewSettleTime)) {
+    QWriteLocker locker(&m_readWriteLock);
+    m_previewing = false;
+  }
+
+  updatePriorityRegion();
+
+  regularUpdata__checkRedraw();
+
+  {
+    ChunkCache::Locker locker(*cache);
+
+    {
+      // chunks of the same group are collected into one job
+      const int maxRenderJobsPerUpdate = 64;
+      QHash<ChunkGroupID, RenderItem> jobs;
+
+      while (chunksToRedraw.size() > 0)
+      {
+        const auto id = chunksToRedraw.dequeue();
+        const ChunkGroupID cgid = ChunkGroupID::fromCoordinates(id.first.getX(), id.first.getZ());
+        if (!jobs.contains(cgid) && (jobs.size() >= maxRenderJobsPerUpdate))
+        {
+          chunksToRedraw.prepend(id);
+          break;  // continue with next update
+        }
+
+        ChunkRenderer::GroupItem chunkItem;
+        QSharedPointer<Chunk> chunk = id.second;
+        if (!chunk)
+        {
+          // only shading flags changed -> no need to load and scan the chunk again
+          if (!getShadingOnlyItem(id.first, chunkItem))
+          {
+            const bool known = locker.fetch(chunk, id.first, ChunkCache::FetchBehaviour::USE_CACHED_OR_UDPATE);
+            if (known && !chunk)
+            {
+              markChunkNonExisting(id.first);
+            }
+          }
+        }
+
+        if (chunk)
+        {
+          chunkItem = createRenderItem(chunk);
+        }
+        if (chunkItem.rendered)
+        {
+          RenderItem& job = jobs[cgid];
+          if (!job.group)
+          {
+            job.group = renderedChunkGroupsCache.lock()().findOrCreate(cgid);
+            m_redrawCheckPending = true;  // might have evicted a visible group
+          }
+          job.chunks.append(chunkItem);
+        }
+      }
+
+      for (RenderItem& job: jobs)
+      {
+        const QVector<ChunkRenderer::GroupItem> chunks = job.chunks;
+        if (!m_renderStage.push(std::move(job)))
+        {
+          // render stage is full, continue with next update
+          for (const auto& chunkItem: chunks)
+          {
+            chunksToRedraw.prepend(std::pair<ChunkID, QSharedPointer<Chunk>>(
+                ChunkID(chunkItem.rendered->chunkX, chunkItem.rendered->chunkZ), chunkItem.chunk));
+          }
+        }
+      }
+    }
+  }
+
+  m_compositeStage.processPending(std::numeric_limits<size_t>::max());
+  m_storeApplyStage.processPending(std::numeric_limits<size_t>::max());
+  m_pyramidApplyStage.processPending(std::numeric_limits<size_t>::max());
+
+  updatePyramid();
+
+  checkViewportComplete();
+
+  redraw__changed();
+
+  updateCacheSize(false);
+}
+
+void MapView::regularUpdata__checkRedraw()
+{
+  const int maxIterLoadAndRender = 10000;
+
+  DrawHelper h(x, z, zoom * overscanZoomFactor, size());
+
+  ChunkGroupDrawRegion cgit(h.cam);
+
+  if (isPyramidZoom())
+  {
+    regularUpdata__checkRedraw_pyramid(cgit.getRect());  // locks the rendered groups itself
+    return;
+  }
+
+  RedrawCheck check;
+  check.x = x;
+  check.z = z;
+  check.zoom = zoom;
+  check.size = size();
+  check.current = getCurrentRenderParams();
+  check.request = getRequestParams();
+  check.previewing = m_previewing;
+  check.renderEpoch = m_renderEpoch;
+  if (!m_redrawCheckPending && (check == m_redrawChecked))
+  {
+    return;  // nothing changed since the last complete check
+  }
+  m_redrawChecked = check;
+  m_redrawCheckPending = false;
+
+  ChunkCache::Locker locker(*cache);
+  auto lockRendered = renderedChunkGroupsCache.lock();
+
+  chunkRedrawIterator.setRange(cgit.chunkGroupsWide, cgit.chunkGroupsTall, true);
+  const int maxIters = cgit.chunkGroupsWide * cgit.chunkGroupsTall;
+
+  for (int i = 0; i < maxIters; i++)
+  {
+    std::pair<int, int> id = chunkRedrawIterator.getNext(cgit.rootTopLeftChunkGroupId.getX(), cgit.rootTopLeftChunkGroupId.getZ());
+    ChunkGroupID cgid(id.first, id.second);
+
+    auto data = lockRendered().findOrCreate(cgid);
+    if (data && redrawNeeded(*data) && !requestStoredGroup(cgid, data))
+    {
+      regularUpdata__checkRedraw_chunkGroup(cgid, *data);
+
+      if (chunksToRedraw.size() > maxIterLoadAndRender)
+      {
+        m_redrawCheckPending = true;  // continue with next update
+        return;
+      }
+    }
+  }
+}
+
+void MapView::regularUpdata__checkRedraw_chunkGroup(const ChunkGroupID &cgid, RenderGroupData &data)
+{
+  data.renderedFor = getRequestParams();
+
+  for(auto coordinate : cgid)
+  {
+    const ChunkID cid(coordinate.getX(), coordinate.getZ());
+    auto& state = data.states[cid];
+
+    if (state.flags[RenderStateT::Empty] || state.flags[RenderStateT::LoadingRequested] || isRenderingRequested(state))
+    {
+      continue;
+    }
+
+    if (redrawNeeded(state))
+    {
+      chunksToRedraw.enqueue(std::pair<ChunkID, QSharedPointer<Chunk>>(cid, QSharedPointer<Chunk>()));
+      state.flags.set(RenderStateT::RenderingRequested);
+      state.requestEpoch = m_renderEpoch;
+    }
+  }
+}
+
+void MapView::regularUpdata__checkRedraw_pyramid(const QRect& chunkGroups)
+{
+  // far too many groups are visible to keep them all: the ones closest to the center that the pyramid
+  // doesn't have yet are rendered, then dropped from the cache again
+  const RenderParams current = getCurrentRenderParams();
+  const ChunkGroupID center = ChunkGroupID::fromCoordinates(x / ChunkID::SIZE_N, z / ChunkID::SIZE_N);
+
+  QVector<ChunkGroupID> missing;
+  forEachWorldGroupIn(chunkGroups, [&](const ChunkGroupID& cgid) {
+    if (!m_pyramid.isComplete(cgid, current))
+    {
+      missing.append(cgid);
+    }
+    return true;
+  });
+
+  const auto distance = [&center](const ChunkGroupID& cgid) {
+    const int dx = cgid.getX() - center.getX();
+    const int dz = cgid.getZ() - center.getZ();
+    return dx * dx + dz * dz;
+  };
+  const int count = std::min(missing.size(), maxPyramidGroupsInFlight);
+  std::partial_sort(missing.begin(), missing.begin() + count, missing.end(),
+                    [&distance](const ChunkGroupID& a, const ChunkGroupID& b) { return distance(a) < distance(b); });
+
+  auto lockRendered = renderedChunkGroupsCache.lock();
+  for (int i = 0; i < count; i++)
+  {
+    auto data = lockRendered().findOrCreate(missing[i]);
+    if (data && redrawNeeded(*data) && !requestStoredGroup(missing[i], data))
+    {
+      regularUpdata__checkRedraw_chunkGroup(missing[i], *data);
+    }
+  }
+}
+
+void MapView::updatePyramid()
+{
+  const RenderParams current = getCurrentRenderParams();
+  auto lock = renderedChunkGroupsCache.lock();
 
-    if (grData && renderedChunk)
+  for (auto it = m_pyramidDirty.begin(); it != m_pyramidDirty.end(); )
+  {
+    PyramidItem item;
+    item.cgid = *it;
+    item.group = lock()[item.cgid];
+    item.params = current;
+    item.complete = true;
+    item.timestamp = 0;
+
+    if (item.group)
     {
+      for (auto coordinate: item.cgid)
       {
-        ChunkGroupRendererC renderer(*grData, cgID);
-        renderer.drawChunk(id, renderedChunk);
+        const auto state = item.group->states.find(ChunkID(coordinate.getX(), coordinate.getZ()));
+        if (!state || isRenderingRequested(*state) || !state->renderedFor.isValidFor(current))
+        {
+          item.complete = false;
+          break;
+        }
       }
 
-      renderedChunk->freeImageData();
+      // complete groups are saved once, the timestamp was read before rendering
+      const auto group = item.group;
+      const bool save = item.complete && m_tileStore && m_groupTimestamps.contains(item.cgid) &&
+                        (group->storeState != RenderGroupData::StoreState::Saved);
+      if (save)
+      {
+        item.store = m_tileStore;
+        item.timestamp = m_groupTimestamps.value(item.cgid);
+      }
 
-      auto& state = grData->states[id];
-      state.flags.unset(RenderStateT::RenderingRequested);
-      state.renderedFor = renderedChunk->renderedFor;
+      if (!m_pyramidStage.push(std::move(item)))
+      {
+        return;  // pyramid stage is full, continue with next update
+      }
 
-      grData->renderedFor.invalidate();
+      if (save)
+      {
+        group->storeState = RenderGroupData::StoreState::Saved;
+      }
     }
+
+    it = m_pyramidDirty.erase(it);
   }
 }
 
-void MapView::regularUpdate()
+bool MapView::requestStoredGroup(const ChunkGroupID& cgid, const QSharedPointer<RenderGroupData>& group)
 {
-  if (!this->isEnabled()) {
-    return;
+  if (group->storeState == RenderGroupData::StoreState::Loading)
+  {
+    return true;  // the chunks are requested when it's loaded
   }
 
-  updateCacheSize(true);
+  const RenderParams current = getCurrentRenderParams();
+  if (!m_tileStore || !m_groupTimestamps.contains(cgid) || (group->storeLookupFor == current))
+  {
+    return false;
+  }
 
-  regularUpdata__checkRedraw();
+  StoreItem item;
+  item.cgid = cgid;
+  item.group = group;
+  item.store = m_tileStore;
+  item.params = current;
+  item.found = false;
+  if (!m_storeLoadStage.push(std::move(item)))
+  {
+    m_redrawCheckPending = true;
+    return true;  // stage is full, continue with next update
+  }
 
-  const int maxIterLoadAndRender = 100000;
+  group->storeState = RenderGroupData::StoreState::Loading;
+  group->storeLookupFor = current;
+  return true;
+}
 
+void MapView::applyStoredGroup(StoreItem& item)
+{
+  auto cgLock = renderedChunkGroupsCache.lock();
+  auto grData = cgLock()[item.cgid];
+  if (!grData || (grData != item.group) || (item.store != m_tileStore))
   {
-    ChunkCache::Locker locker(*cache);
+    return;  // evicted or another world in the meantime
+  }
 
-    {
-      size_t i = 0;
-      while (chunksToRedraw.size() > 0)
-      {
-        const auto id = chunksToRedraw.dequeue();
+  grData->storeState = RenderGroupData::StoreState::Loaded;
+  grData->renderedFor.invalidate();  // the chunks not covered by the stored images are requested now
+  m_redrawCheckPending = true;
+  if (!item.found)
+  {
+    return;
+  }
 
-        QSharedPointer<Chunk> chunk = id.second;
-        if (!chunk)
-        {
-          locker.fetch(chunk, id.first, ChunkCache::FetchBehaviour::USE_CACHED_OR_UDPATE);
-        }
+  const RenderParams current = getCurrentRenderParams();
+  if ((item.params.renderedAt != current.renderedAt) || (item.params.renderedFlags != current.renderedFlags))
+  {
+    return;  // superseded while it was loaded, e.g. by dragging the depth slider
+  }
 
-        if (chunk)
-        {
-          size_t currentQueueLength = renderChunkAsync(chunk);
-          i++;
-          if ((i > maxIterLoadAndRender) || (currentQueueLength > maxIterLoadAndRender))
-          {
-            break;
-          }
-        }
-      }
+  for (auto coordinate: item.cgid)
+  {
+    const auto state = grData->states.find(ChunkID(coordinate.getX(), coordinate.getZ()));
+    if (state && state->renderedFor.isValidFor(current))
+    {
+      return;  // rendered in the meantime, e.g. for a tooltip
     }
   }
 
-  redraw();
-  update();
+  {
+    QMutexLocker locker(&grData->imageMutex);
+    const QSize size = ChunkGroupID::getSize() / current.lod;
+    grData->renderedImg = item.tile.renderedImg.convertToFormat(QImage::Format_RGB32)
+                                               .scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    grData->depthImg = item.tile.depthImg.convertToFormat(QImage::Format_Grayscale8).scaled(size);
+  }
+  m_pyramidDirty.insert(item.cgid);
+  m_redrawGroups.insert(item.cgid);
 
-  updateCacheSize(false);
+  // a stale tile is only shown until its chunks are rendered again, entities need the chunks as well
+  const bool upToDate = (item.params == current) && (item.tile.timestamp >= m_groupTimestamps.value(item.cgid)) &&
+                        ((current.renderedFlags & flgShowEntities) == 0);
+  if (!upToDate)
+  {
+    return;
+  }
+
+  for (auto coordinate: item.cgid)
+  {
+    auto& state = grData->states[ChunkID(coordinate.getX(), coordinate.getZ())];
+    state.flags.unset(RenderStateT::RenderingRequested);
+    state.renderedFor = current;
+  }
+  grData->storeState = RenderGroupData::StoreState::Saved;
 }
 
-void MapView::regularUpdata__checkRedraw()
+void MapView::loadStoredPyramid()
 {
-  const int maxIterLoadAndRender = 10000;
-
-  ChunkCache::Locker locker(*cache);
-  auto lockRendered = renderedChunkGroupsCache.lock();
-
-  DrawHelper h(x, z, zoom * overscanZoomFactor, imageChunks.size());
+  m_pyramidLoadStage.clear();
+  m_pyramidApplyStage.clear();
+  if (!m_tileStore)
+  {
+    return;
+  }
 
-  ChunkGroupDrawRegion cgit(h.cam);
+  PyramidStoreItem item;
+  item.store = m_tileStore;
+  item.params = m_pyramid.getParams();
+  item.groupTimestamps = m_groupTimestamps;
+  m_pyramidLoadStage.push(std::move(item));  // both stages were just cleared
+}
 
-  chunkRedrawIterator.setRange(cgit.chunkGroupsWide, cgit.chunkGroupsTall, true);
-  const int maxIters = cgit.chunkGroupsWide * cgit.chunkGroupsTall;
+void MapView::saveStoredPyramid()
+{
+  if (!m_tileStore)
+  {
+    return;
+  }
 
-  for (int i = 0; i < maxIters; i++)
+  PyramidStoreItem item;
+  item.store = m_tileStore;
+  item.params = m_pyramid.getParams();  // the tiles were fed with
+  item.groupTimestamps = m_groupTimestamps;
+  item.tiles = m_pyramid.takeChangedTiles();
+  if (!item.tiles.isEmpty() && !m_pyramidSaveStage.push(std::move(item)))
   {
-    std::pair<int, int> id = chunkRedrawIterator.getNext(cgit.rootTopLeftChunkGroupId.getX(), cgit.rootTopLeftChunkGroupId.getZ());
-    ChunkGroupID cgid(id.first, id.second);
+    savePyramidTiles(item);  // stage is full
+  }
+}
 
-    auto data = lockRendered().findOrCreate(cgid);
-    if (data && redrawNeeded(*data))
+void MapView::loadPyramidTiles(PyramidStoreItem& item)
+{
+  for (int level = TilePyramid::MinLevel; level <= TilePyramid::MaxLevel; level++)
+  {
+    const auto newest = TilePyramid::getTileTimestamps(level, item.groupTimestamps);
+    const auto tiles = item.store->loadPyramidLevel(item.params, level);
+    for (auto it = tiles.begin(); it != tiles.end(); ++it)
     {
-      regularUpdata__checkRedraw_chunkGroup(cgid, *data);
-
-      if (chunksToRedraw.size() > maxIterLoadAndRender)
+      // stale when a chunk beneath it was saved afterwards, tiles of unknown timestamps are never saved
+      if (it->timestamp >= newest.value(it.key(), 0))
       {
-        return;
+        item.tiles.append(TilePyramid::Tile{level, it.key(), it->image});
       }
     }
   }
 }
 
-void MapView::regularUpdata__checkRedraw_chunkGroup(const ChunkGroupID &cgid, RenderGroupData &data)
+void MapView::savePyramidTiles(const PyramidStoreItem& item)
 {
-  data.renderedFor = getCurrentRenderParams();
-
-  for(auto coordinate : cgid)
+  QHash<CoordinateID, quint32> newest[TilePyramid::MaxLevel - TilePyramid::MinLevel + 1];
+  for (int level = TilePyramid::MinLevel; level <= TilePyramid::MaxLevel; level++)
   {
-    const ChunkID cid(coordinate.getX(), coordinate.getZ());
-    auto& state = data.states[cid];
+    newest[level - TilePyramid::MinLevel] = TilePyramid::getTileTimestamps(level, item.groupTimestamps);
+  }
 
-    if (state.flags[RenderStateT::Empty] || state.flags[RenderStateT::LoadingRequested] || state.flags[RenderStateT::RenderingRequested])
+  for (const auto& tile: item.tiles)
+  {
+    const quint32 timestamp = newest[tile.level - TilePyramid::MinLevel].value(tile.id, 0);
+    if (timestamp != std::numeric_limits<quint32>::max())
     {
-      continue;
+      item.store->savePyramidTile(item.params, tile.level, tile.id, TileStore::PyramidTile{tile.image, timestamp});
     }
+  }
+}
 
-    if (redrawNeeded(state))
-    {
-      chunksToRedraw.enqueue(std::pair<ChunkID, QSharedPointer<Chunk>>(cid, QSharedPointer<Chunk>()));
-      state.flags.set(RenderStateT::RenderingRequested);
-    }
+void MapView::updatePyramidSettings()
+{
+  const RenderParams previous = m_pyramid.getParams();
+  const RenderParams current = getCurrentRenderParams();
+  if ((previous.renderedAt == current.renderedAt) &&
+      (((previous.renderedFlags ^ current.renderedFlags) & ~flgShowEntities) == 0))
+  {
+    return;  // same images
   }
+
+  // the tiles of the previous settings go to their own directory, the ones of the current settings are shown
+  saveStoredPyramid();
+  m_pyramid.clear(current);
+  loadStoredPyramid();
+  m_pyramidTilesChanged = true;
 }
 
 MapCamera CreateCameraForChunkGroup(const ChunkGroupID& cgid)
@@ -668,6 +1548,7 @@ void MapView::mouseMoveEvent(QMouseEvent *event) {
   x += (lastMousePressPosition.x()-event->x()) / zoom;
   z += (lastMousePressPosition.y()-event->y()) / zoom;
   lastMousePressPosition = event->pos();
+  update();  // the latest frame moved, see paintEvent()
 }
 
 void MapView::mouseReleaseEvent(QMouseEvent * event) {
@@ -762,20 +1643,30 @@ void MapView::keyPressEvent(QKeyEvent *event) {
   }
 }
 
-void MapView::resizeEvent(QResizeEvent *event) {
-  imageChunks   = QImage(event->size(), QImage::Format_RGB32);
-  //imageOverlays = QImage(event->size(), QImage::Format_RGBA8888);
-  imageOverlays = QImage(event->size(), QImage::Format_ARGB32_Premultiplied);
-  image_players = QImage(event->size(), QImage::Format_ARGB32_Premultiplied);
-
-  redraw();
+void MapView::resizeEvent(QResizeEvent * /* event */) {
+  redraw();  // the layers are resized by composeFrame()
 }
 
-void MapView::paintEvent(QPaintEvent * /* event */) {
+void MapView::paintEvent(QPaintEvent *event) {
+  const TripleFrameBuffer::Frame& frame = m_frames.front();
+  const QRect rect = event->rect();
   QPainter p(this);
-  p.drawImage(QPoint(0, 0), imageChunks);
-  p.drawImage(QPoint(0, 0), imageOverlays);
-  p.drawImage(QPoint(0, 0), image_players);
+
+  // until the frame for the current view is composited, the latest one is shown moved and scaled to it
+  const double scale = zoom / frame.zoom;
+  const QRectF target((frame.x - x) * zoom + (width() - frame.image.width() * scale) / 2,
+                      (frame.z - z) * zoom + (height() - frame.image.height() * scale) / 2,
+                      frame.image.width() * scale, frame.image.height() * scale);
+
+  if (target == QRectF(frame.image.rect()))
+  {
+    p.drawImage(rect, frame.image, rect);  // only the part that was updated
+  }
+  else
+  {
+    p.fillRect(rect, QColor(0xee, 0xee, 0xee));
+    p.drawImage(target, frame.image);
+  }
   p.end();
 }
 
@@ -813,154 +1704,419 @@ void DrawHelper3::drawEntityMap(const Chunk::EntityMap &map,
 }
 
 void MapView::redraw() {
+  m_composited.valid = false;
+  redraw__changed();
+}
+
+void MapView::redraw__changed() {
+  if (m_frameInFlight)
+  {
+    return;  // the changes are collected until the compositor is done
+  }
 
-  image_players.fill(0);
-  imageOverlays.fill(0);
+  FrameItem item;
+  CompositedView& view = item.view;
 
   if (!this->isEnabled()) {
+    if (m_composited.blank && (m_composited.size == size())) {
+      return;
+    }
+
     // blank
-    imageChunks.fill(0xeeeeee);
-    update();
+    item.blank = true;
+    item.dirty = QRegion(rect());
+    view.x = x;
+    view.z = z;
+    view.zoom = zoom;
+    view.size = size();
+    view.blank = true;
+    m_frameInFlight = m_frameStage.push(std::move(item));
+    if (m_frameInFlight) {
+      m_composited = view;  // not valid, drawn completely once enabled
+    }
     return;
   }
 
-  const bool displayDepthMap = QSettings().value("depthmapview", false).toBool();
-  const bool chunkgroupstatus = QSettings().value("chunkgroupstatus", false).toBool();
-  const bool chunkCacheSatus = QSettings().value("chunkcachestatus", false).toBool();
-
-  const auto locker = chunkCacheSatus ? std::make_unique<ChunkCache::Locker>(*cache) : nullptr;
+  const bool displayDepthMap = m_displayDepthMap;
+  const bool chunkgroupstatus = m_chunkGroupStatus;
+  const bool chunkCacheSatus = m_chunkCacheStatus;
 
-  auto renderdCacheLock = renderedChunkGroupsCache.lock();
-
-  DrawHelper h(x,z,zoom,imageChunks.size());
-  DrawHelper3 h2(h, imageChunks, imageOverlays, image_players);
+  DrawHelper h(x,z,zoom,size());
 
   const auto camera = h.cam;
 
   ChunkGroupDrawRegion cgit(h.cam);
 
-  QImage placeholderImg = getChunkGroupPlaceholder().copy();
+  view.valid = true;
+  view.x = x;
+  view.z = z;
+  view.zoom = zoom;
+  view.size = size();
+  view.depth = depth;
+  view.flags = flags;
+  view.depthMap = displayDepthMap;
+
+  const int pyramidLevel = TilePyramid::levelForZoom(zoom);
+  const bool pyramidChanged = m_pyramidTilesChanged.exchange(false) && (pyramidLevel >= TilePyramid::MinLevel);
+  const QRect all = rect();
+
+  // the status overlays change with every frame
+  QRegion dirty;
+  if (!m_composited.valid || chunkgroupstatus || chunkCacheSatus || pyramidChanged ||
+      (view.zoom != m_composited.zoom) || (view.size != m_composited.size) || (view.depth != m_composited.depth) ||
+      (view.flags != m_composited.flags) || (view.depthMap != m_composited.depthMap))
+  {
+    dirty = all;
+  }
+  else
+  {
+    const double dx = (m_composited.x - x) * zoom;
+    const double dz = (m_composited.z - z) * zoom;
+    if ((std::abs(dx - std::round(dx)) > 1e-6) || (std::abs(dz - std::round(dz)) > 1e-6))
+    {
+      dirty = all;
+    }
+    else if ((dx != 0.0) || (dz != 0.0))
+    {
+      item.shift = QPoint(static_cast<int>(std::round(dx)), static_cast<int>(std::round(dz)));
+      dirty = QRegion(all).subtracted(all.translated(item.shift));
+    }
+
+    // the pyramid tiles are only drawn again when the pyramid stage changed them
+    if (pyramidLevel < TilePyramid::MinLevel)
+    {
+      for (const auto& cgid: m_redrawGroups)
+      {
+        const auto topLeft = ChunkID(cgid.topLeft().getX(), cgid.topLeft().getZ()).topLeft();
+        const QRectF groupRect(camera.getPixelFromBlockCoordinates(TopViewPosition(topLeft.getX(), topLeft.getZ())),
+                               camera.getPixelFromBlockCoordinates(
+                                 TopViewPosition(topLeft.getX() + 16 * ChunkGroupID::SIZE_N,
+                                                 topLeft.getZ() + 16 * ChunkGroupID::SIZE_N)));
+        dirty += groupRect.toAlignedRect().adjusted(-overlayMargin, -overlayMargin, overlayMargin, overlayMargin) & all;
+      }
+    }
 
-  RenderGroupData renderedDataDummy;
-  renderedDataDummy.renderedImg = placeholderImg.copy();
+    for (const auto& damage: m_overlayDamage)
+    {
+      const QRectF damageRect(camera.getPixelFromBlockCoordinates(TopViewPosition(damage.left(), damage.top())),
+                              camera.getPixelFromBlockCoordinates(TopViewPosition(damage.right(), damage.bottom())));
+      dirty += damageRect.toAlignedRect().adjusted(-overlayMargin, -overlayMargin, overlayMargin, overlayMargin) & all;
+    }
+  }
 
-  if (chunkgroupstatus)
+  if (dirty.isEmpty() && item.shift.isNull())
   {
-    renderedDataDummy.renderedImg.fill(Qt::red);
-    placeholderImg.fill(Qt::green);
+    m_redrawGroups.clear();
+    m_overlayDamage.clear();
+    return;  // nothing changed since the last frame
   }
 
-  QBrush b(Qt::Dense6Pattern);
-  h2.getCanvas().setPen(QPen(Qt::PenStyle::NoPen));
+  item.dirty = dirty;
+  item.pyramidLevel = pyramidLevel;
 
-  for (auto point: cgit)
+  // the snapshot shares the images, a render job writing into them meanwhile detaches its own copy
+  if (pyramidLevel >= TilePyramid::MinLevel)
+  {
+    redraw__pyramid(h, item, pyramidLevel);
+  }
+  else
   {
-    const auto cgid = ChunkGroupID(point.getX(), point.getZ());
-    const auto topLeftChunk = ChunkID(cgid.topLeft().getX(), cgid.topLeft().getZ());
+    const auto locker = chunkCacheSatus ? std::make_unique<ChunkCache::Locker>(*cache) : nullptr;
+    auto renderdCacheLock = renderedChunkGroupsCache.lock();
 
-    auto it = renderdCacheLock()[cgid];
-    RenderGroupData& renderedData = it ? *it : renderedDataDummy;
+    QImage placeholderImg = getChunkGroupPlaceholder();
+    QImage missingImg = placeholderImg;
 
-    const auto topLeftInBlocks = TopViewPosition(topLeftChunk.topLeft().getX(), topLeftChunk.topLeft().getZ());
-    const auto topLeftInPixeln = camera.getPixelFromBlockCoordinates(topLeftInBlocks);
-    const auto bottomRightInPixeln = camera.getPixelFromBlockCoordinates(
-          TopViewPosition(topLeftInBlocks.x + 16 * ChunkGroupID::SIZE_N,
-                          topLeftInBlocks.z + 16 * ChunkGroupID::SIZE_N));
-    QRectF targetRect(topLeftInPixeln, bottomRightInPixeln);
+    if (chunkgroupstatus)
+    {
+      missingImg = QImage(placeholderImg.size(), placeholderImg.format());
+      missingImg.fill(Qt::red);
+      placeholderImg = QImage(placeholderImg.size(), placeholderImg.format());
+      placeholderImg.fill(Qt::green);
+    }
 
-    const QImage& imageToDraw = displayDepthMap ? renderedData.depthImg : renderedData.renderedImg;
+    for (auto point: cgit)
+    {
+      const auto cgid = ChunkGroupID(point.getX(), point.getZ());
+      const auto topLeftChunk = ChunkID(cgid.topLeft().getX(), cgid.topLeft().getZ());
+
+      const auto topLeftInBlocks = TopViewPosition(topLeftChunk.topLeft().getX(), topLeftChunk.topLeft().getZ());
+      const auto topLeftInPixeln = camera.getPixelFromBlockCoordinates(topLeftInBlocks);
+      const auto bottomRightInPixeln = camera.getPixelFromBlockCoordinates(
+            TopViewPosition(topLeftInBlocks.x + 16 * ChunkGroupID::SIZE_N,
+                            topLeftInBlocks.z + 16 * ChunkGroupID::SIZE_N));
+      QRectF targetRect(topLeftInPixeln, bottomRightInPixeln);
+
+      // entities of the neighbors reach into the region as well
+      if (!dirty.intersects(targetRect.toAlignedRect().adjusted(-overlayMargin, -overlayMargin, overlayMargin, overlayMargin)))
+      {
+        continue;
+      }
 
-    h2.getCanvas().drawImage(targetRect, imageToDraw.isNull() ? placeholderImg : imageToDraw);
+      FrameItem::Group group;
+      group.cgid = cgid;
+      group.target = targetRect;
 
-    for (const auto& entityMap: renderedData.entities)
-    {
-      if (entityMap)
+      auto it = renderdCacheLock()[cgid];
+      if (!it)
       {
-        h2.drawEntityMap(*entityMap, cgid, renderedData, overlayItemTypes, depth, zoom);
+        group.image = missingImg;
+        item.groups.append(group);
+        continue;
       }
-    }
 
-    if (chunkCacheSatus)
-    {
-      const bool isActuallyChunkDataAvailable = (it && !imageToDraw.isNull());
-      if (isActuallyChunkDataAvailable)
+      QMutexLocker imageLocker(&it->imageMutex);  // render jobs write into the images
+
+      const QImage& imageToDraw = displayDepthMap ? it->depthImg : it->renderedImg;
+      group.image = imageToDraw.isNull() ? placeholderImg : imageToDraw;
+
+      if (!it->entities.isEmpty())
+      {
+        group.overlays = QSharedPointer<RenderGroupData>::create();
+        group.overlays->depthImg = it->depthImg;
+        group.overlays->entities = it->entities;
+      }
+
+      if (chunkCacheSatus && !imageToDraw.isNull())
       {
         for(auto coordinate : cgid)
         {
           const ChunkID cid(coordinate.getX(), coordinate.getZ());
-          const bool isCached = (*locker).isCached(cid);
-          b.setColor(isCached ? Qt::green : Qt::red);
-
           CoordinateID b1 = cid.topLeft();
           CoordinateID b2 = cid.bottomRight();
           QRectF rect(camera.getPixelFromBlockCoordinates(TopViewPosition(b1.getX(), b1.getZ())),
                       camera.getPixelFromBlockCoordinates(TopViewPosition(b2.getX(), b2.getZ())));
-
-          h2.getCanvas().setBrush(b);
-          h2.getCanvas().drawRect(rect);
+          group.cachedChunks.append(std::make_pair(rect, (*locker).isCached(cid)));
         }
       }
+
+      item.groups.append(group);
     }
   }
 
-  // add on the entity layer
-  // done as part of drawChunk
-
-  const OverlayItem::Point p1(h.x1 - 1, 0, h.z1 - 1);
-  const OverlayItem::Point p2(h.x2 + 1, depth, h.z2 + 1);
+  item.overlayItemTypes = overlayItemTypes;
 
-  // draw the generated structures
+  // generated structures
+  const QRect dirtyBounds = dirty.boundingRect().adjusted(-overlayMargin, -overlayMargin, overlayMargin, overlayMargin);
+  const OverlayItem::Point p1(h.x1 + dirtyBounds.left() / zoom - 1, 0, h.z1 + dirtyBounds.top() / zoom - 1);
+  const OverlayItem::Point p2(h.x1 + (dirtyBounds.right() + 1) / zoom + 1, depth, h.z1 + (dirtyBounds.bottom() + 1) / zoom + 1);
   for (auto &type : overlayItemTypes) {
-    for (auto &item : overlayItems[type]) {
-      if (item->intersects(p1, p2)) {
-        item->draw(h.x1, h.z1, zoom, &h2.getCanvas());
-      }
-    }
+    item.structures += overlayItems.query(type, p1, p2);
   }
 
-  h2.getCanvas().setPen(QPen(Qt::PenStyle::SolidLine));
+  item.players = currentPlayers;
+  item.players += currentSearchResults;
+
+  if (chunkgroupstatus)
+  {
+    item.status << (m_viewportMeasurementPending
+                    ? QString("viewport rendering: %1 ms").arg(m_viewportTimer.elapsed())
+                    : QString("viewport complete after: %1 ms").arg(m_lastViewportCompleteTime));
+
+    for (const auto& stage: getPipelineStats())
+    {
+      item.status << QString("%1: queued %2+%3/%4 running %5/%6 done %7 dropped %8 - %9/s")
+                     .arg(stage.name)
+                     .arg(stage.queued).arg(stage.reserved).arg(stage.capacity)
+                     .arg(stage.running).arg(stage.parallelism)
+                     .arg(stage.processed).arg(stage.dropped)
+                     .arg(stage.throughput, 0, 'f', 1);
+    }
+  }
 
-  const int maxViewWidth = 64 * 16; // (radius 32 chunks)
+  const bool viewChanged = !m_composited.valid || (view.x != m_composited.x) || (view.z != m_composited.z) ||
+                           (view.depth != m_composited.depth);
 
-  const double firstGridLineX = ceil(h.x1 / maxViewWidth) * maxViewWidth;
-  for (double x = firstGridLineX; x < h.x2; x += maxViewWidth)
+  m_frameInFlight = true;
+  if (!m_frameStage.push(std::move(item)))
   {
-    const int line_x = round((x - h.x1) * zoom);
-    h2.getCanvas().drawLine(line_x, 0, line_x, imageChunks.height());
+    m_frameInFlight = false;
+    return;  // frame stage is full, continue with next update
   }
 
-  const double firstGridLineZ = ceil(h.z1 / maxViewWidth) * maxViewWidth;
-  for (double z = firstGridLineZ; z < h.z2; z += maxViewWidth)
+  m_composited = view;
+  m_redrawGroups.clear();
+  m_overlayDamage.clear();
+
+  if (viewChanged)
   {
-    const int line_z = round((z - h.z1) * zoom);
-    h2.getCanvas().drawLine(0, line_z, imageChunks.width(), line_z);
+    emit(coordinatesChanged(x, depth, z));
   }
+}
 
-  h2.drawOverlayItemToPlayersCanvas(currentPlayers);
-  h2.drawOverlayItemToPlayersCanvas(currentSearchResults);
+void MapView::redraw__pyramid(const DrawHelper& h, FrameItem& item, int level)
+{
+  const int tileBlocks = TilePyramid::getTileRect(level, CoordinateID(0, 0)).width();
+  const int firstX = static_cast<int>(floor(h.x1 / tileBlocks));
+  const int firstZ = static_cast<int>(floor(h.z1 / tileBlocks));
+  const int lastX = static_cast<int>(floor(h.x2 / tileBlocks));
+  const int lastZ = static_cast<int>(floor(h.z2 / tileBlocks));
 
-  emit(coordinatesChanged(x, depth, z));
+  for (int tz = firstZ; tz <= lastZ; tz++)
+  {
+    for (int tx = firstX; tx <= lastX; tx++)
+    {
+      const CoordinateID tileID(tx, tz);
+      const QImage tile = m_pyramid.getTile(level, tileID);
+      if (tile.isNull())
+      {
+        continue;
+      }
 
-  update();
+      const QRect area = TilePyramid::getTileRect(level, tileID);
+      const QRectF targetRect(h.cam.getPixelFromBlockCoordinates(TopViewPosition(area.left(), area.top())),
+                              h.cam.getPixelFromBlockCoordinates(TopViewPosition(area.left() + area.width(),
+                                                                                 area.top() + area.height())));
+      item.tiles.append(std::make_pair(targetRect, tile));
+    }
+  }
 }
 
-void DrawHelper2::drawChunk_Map(int x, int z, const QSharedPointer<RenderedChunk>& renderedChunk) {
+QRegion MapView::composeFrame(FrameItem& item)
+{
+  const CompositedView& view = item.view;
+  QRegion dirty = item.dirty;
+
+  if ((imageChunks.size() != view.size) || item.blank)
+  {
+    imageChunks   = QImage(view.size, QImage::Format_RGB32);
+    //imageOverlays = QImage(view.size, QImage::Format_RGBA8888);
+    imageOverlays = QImage(view.size, QImage::Format_ARGB32_Premultiplied);
+    image_players = QImage(view.size, QImage::Format_ARGB32_Premultiplied);
+    dirty = QRegion(imageChunks.rect());
+  }
+  else if (!item.shift.isNull())
+  {
+    scrollImage(imageChunks, item.shift.x(), item.shift.y());
+    scrollImage(imageOverlays, item.shift.x(), item.shift.y());
+    scrollImage(image_players, item.shift.x(), item.shift.y());
+  }
+
+  fillRegion(image_players, dirty, 0);
+  fillRegion(imageOverlays, dirty, 0);
+
+  if (item.blank)
+  {
+    imageChunks.fill(0xeeeeee);
+  }
+  else
+  {
+    DrawHelper h(view.x, view.z, view.zoom, view.size);
+    DrawHelper3 h2(h, imageChunks, imageOverlays, image_players);
+    h2.setClipRegion(dirty);
+
+    QBrush b(Qt::Dense6Pattern);
+    h2.getCanvas().setPen(QPen(Qt::PenStyle::NoPen));
+
+    if (item.pyramidLevel >= TilePyramid::MinLevel)
+    {
+      h2.getCanvas().fillRect(imageChunks.rect(), QColor(TilePyramid::getEmptyColor()));
+      for (const auto& tile: item.tiles)
+      {
+        h2.getCanvas().drawImage(tile.first, tile.second);
+      }
+    }
+
+    for (const auto& group: item.groups)
+    {
+      h2.getCanvas().drawImage(group.target, group.image);
+
+      if (group.overlays)
+      {
+        for (const auto& entityMap: group.overlays->entities)
+        {
+          if (entityMap)
+          {
+            h2.drawEntityMap(*entityMap, group.cgid, *group.overlays, item.overlayItemTypes, view.depth, view.zoom);
+          }
+        }
+      }
+
+      for (const auto& chunk: group.cachedChunks)
+      {
+        b.setColor(chunk.second ? Qt::green : Qt::red);
+        h2.getCanvas().setBrush(b);
+        h2.getCanvas().drawRect(chunk.first);
+      }
+    }
+
+    // add on the entity layer
+    // done as part of drawChunk
+
+    // draw the generated structures
+    for (auto &structure : item.structures) {
+      structure->draw(h.x1, h.z1, view.zoom, &h2.getCanvas());
+    }
+
+    h2.getCanvas().setPen(QPen(Qt::PenStyle::SolidLine));
+
+    // (radius 32 chunks), zoomed out into the tile pyramid the lines stay at least 32 pixels apart
+    const int maxViewWidth = (64 * 16) << std::max(0, item.pyramidLevel - TilePyramid::MinLevel);
+
+    const double firstGridLineX = ceil(h.x1 / maxViewWidth) * maxViewWidth;
+    for (double x = firstGridLineX; x < h.x2; x += maxViewWidth)
+    {
+      const int line_x = round((x - h.x1) * view.zoom);
+      h2.getCanvas().drawLine(line_x, 0, line_x, imageChunks.height());
+    }
+
+    const double firstGridLineZ = ceil(h.z1 / maxViewWidth) * maxViewWidth;
+    for (double z = firstGridLineZ; z < h.z2; z += maxViewWidth)
+    {
+      const int line_z = round((z - h.z1) * view.zoom);
+      h2.getCanvas().drawLine(0, line_z, imageChunks.width(), line_z);
+    }
+
+    h2.drawOverlayItemToPlayersCanvas(item.players);
+
+    if (!item.status.isEmpty())
+    {
+      h2.getCanvas().setPen(Qt::white);
+      h2.getCanvas().drawText(10, 20, item.status.first());
+
+      int textY = 35;
+      for (int i = 1; i < item.status.size(); i++)
+      {
+        h2.getCanvas().drawText(10, textY, item.status[i]);
+        textY += 15;
+      }
+    }
+  }
 
-  const QImage& srcImage = renderedChunk ? renderedChunk->image : getPlaceholder();
-  drawChunk_Map_int(x, z, srcImage);
+  // a scrolled frame differs everywhere, the back buffer is brought up to date with everything it missed
+  const QRegion changed = item.shift.isNull() ? dirty : QRegion(imageChunks.rect());
+  TripleFrameBuffer::Frame& frame = m_frames.back(view.size, QImage::Format_RGB32);
+  const QRegion damage = frame.damage + changed;
+  {
+    QPainter p(&frame.image);
+    p.setClipRegion(damage);
+    p.drawImage(QPoint(0, 0), imageChunks);
+    p.drawImage(QPoint(0, 0), imageOverlays);
+    p.drawImage(QPoint(0, 0), image_players);
+  }
+  frame.x = view.x;
+  frame.z = view.z;
+  frame.zoom = view.zoom;
+  m_frames.publish(changed);
+  return changed;
 }
 
-void DrawHelper2::drawChunk_Map_int(int x, int z, const QImage &srcImage)
+void MapView::frameComposited(const QRegion& changed)
 {
-  double chunksize = chunkSizeOrig * h.zoom;
+  m_frameInFlight = false;
 
-  // this figures out where on the screen this chunk should be drawn
-  const auto topLeft = ChunkID(x, z).topLeft();
-  const QPointF topLeftInPixel = h.cam.getPixelFromBlockCoordinates(TopViewPosition(topLeft.getX(), topLeft.getZ()));
-
-  QRectF targetRect(topLeftInPixel, QSizeF(chunksize, chunksize));
+  // a view moved meanwhile is shown moved, see paintEvent()
+  if ((m_composited.x == x) && (m_composited.z == z) && (m_composited.zoom == zoom))
+  {
+    update(changed);
+  }
+  else
+  {
+    update();
+  }
 
-  canvas.drawImage(targetRect, srcImage);
+  // changes collected meanwhile
+  redraw__changed();
 }
 
 void MapView::getToolTip(int x, int z) {
@@ -1094,34 +2250,41 @@ void MapView::addStructureFromChunk(QSharedPointer<GeneratedStructure> structure
 }
 
 void MapView::addOverlayItem(QSharedPointer<OverlayItem> item) {
-  // test if item is already in list
-  for (auto &it: overlayItems[item->type()]) {
-    OverlayItem::Point p1 = it  ->midpoint();
-    OverlayItem::Point p2 = item->midpoint();
-    if ( (p1.x == p2.x) && (p1.y == p2.y) && (p1.z == p2.z) )
-      return;  // skip if already present
+  // skipped if already present
+  if (!overlayItems.insert(item)) {
+    return;
+  }
+
+  if (overlayItemTypes.contains(item->type()))
+  {
+    DrawHelper h(x, z, zoom, size());
+    if (item->intersects(OverlayItem::Point(h.x1 - 1, 0, h.z1 - 1), OverlayItem::Point(h.x2 + 1, depth, h.z2 + 1)))
+    {
+      m_composited.valid = false;
+    }
   }
-  // otherwise add item
-  overlayItems[item->type()].push_back(item);
 }
 
 void MapView::clearOverlayItems() {
   overlayItems.clear();
+  m_composited.valid = false;
 }
 
 void MapView::setVisibleOverlayItemTypes(const QSet<QString>& itemTypes) {
   overlayItemTypes = itemTypes;
+  m_composited.valid = false;
 }
 
 QList<QSharedPointer<OverlayItem> > MapView::getOverlayItems(const QString &type) const
 {
-  auto it = overlayItems.find(type);
-  if (it != overlayItems.end())
-  {
-    return *it;
-  }
+  return overlayItems.getItems(type);
+}
 
-  return QList<QSharedPointer<OverlayItem> >();
+QVector<PipelineStageStats> MapView::getPipelineStats()
+{
+  return cache->getPipelineStats() << m_storeLoadStage.getStats() << m_storeApplyStage.getStats()
+                                   << m_renderStage.getStats() << m_compositeStage.getStats() << m_pyramidStage.getStats()
+                                   << m_frameStage.getStats();
 }
 
 int MapView::getY(int x, int z) {
@@ -1139,6 +2302,7 @@ int MapView::getY(int x, int z) {
 
   ChunkGroupCamC cam(*it, cgid);
 
+  QMutexLocker imageLocker(&it->imageMutex);
   return cam.getHeightAt(TopViewPosition(x, z));
 }
 
@@ -1154,13 +2318,10 @@ QList<QSharedPointer<OverlayItem>> MapView::getItems(int x, int y, int z) {
     double invzoom = 10.0 / zoom;
     for (auto &type : overlayItemTypes) {
       // generated structures
-      for (auto &item : overlayItems[type]) {
-        double ymin = 0;
-        double ymax = depth;
-        if (item->intersects(OverlayItem::Point(x, ymin, z),
-                             OverlayItem::Point(x, ymax, z))) {
-          ret.append(item);
-        }
+      double ymin = 0;
+      double ymax = depth;
+      for (auto &item : overlayItems.query(type, OverlayItem::Point(x, ymin, z), OverlayItem::Point(x, ymax, z))) {
+        ret.append(item);
       }
 
       // entities
@@ -1201,18 +2362,28 @@ RenderGroupData::RenderGroupData()
 void RenderGroupData::clear()
 {
   entities.clear();
+  gbuffers.clear();
   renderedImg = QImage();
   depthImg = QImage();
   renderedFor = RenderParams();
+  storeState = StoreState::NotLoaded;
+  storeLookupFor = RenderParams();
 }
 
-RenderGroupData& RenderGroupData::init()
+RenderGroupData& RenderGroupData::init(int lod)
 {
+  const QSize size = ChunkGroupID::getSize() / lod;
   if (renderedImg.isNull())
   {
-    renderedImg = getChunkGroupPlaceholder().copy();
-    depthImg = QImage(ChunkGroupID::getSize(), QImage::Format_Grayscale8);
+    renderedImg = getChunkGroupPlaceholder().scaled(size);
+    depthImg = QImage(size, QImage::Format_Grayscale8);
     depthImg.fill(0);
   }
+  else if (renderedImg.size() != size)
+  {
+    // level of detail changed: the scaled image is shown until all chunks are rendered again
+    renderedImg = renderedImg.scaled(size);
+    depthImg = depthImg.scaled(size);
+  }
   return *this;
 }
@@ -9,11 +9,22 @@
 #include "./lockguarded.hpp"
 #include "./enumbitset.hpp"
 #include "./mapviewrenderer.h"
+#include "./pipelinestage.hpp"
+#include "./rendersettings.h"
+#include "./chunkrenderer.h"
+#include "./tilepyramid.h"
+#include "./tilestore.h"
+#include "./tripleframebuffer.h"
+#include "./overlayitemindex.h"
 
 #include <QtWidgets/QWidget>
 #include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QRegion>
 
 #include <QVector>
+#include <algorithm>
+#include <atomic>
 #include <unordered_set>
 
 class DefinitionManager;
@@ -23,25 +34,22 @@ class OverlayItem;
 class DrawHelper;
 class DrawHelper2;
 class DrawHelper3;
-class ChunkRenderer;
 class PriorityThreadPool;
 
 class MapView : public QWidget {
   Q_OBJECT
 
-    friend class ChunkRenderer;
-
  public:
   /// Values for the individual flags
   enum {
-    flgLighting     = 1 << 0,
-    flgMobSpawn     = 1 << 1,
-    flgCaveMode     = 1 << 2,
-    flgDepthShading = 1 << 3,
-    flgShowEntities = 1 << 4,
-    flgSingleLayer  = 1 << 5,
-    flgBiomeColors  = 1 << 6,
-    flgSeaGround    = 1 << 7
+    flgLighting     = RenderSettings::Lighting,
+    flgMobSpawn     = RenderSettings::MobSpawn,
+    flgCaveMode     = RenderSettings::CaveMode,
+    flgDepthShading = RenderSettings::DepthShading,
+    flgShowEntities = RenderSettings::ShowEntities,
+    flgSingleLayer  = RenderSettings::SingleLayer,
+    flgBiomeColors  = RenderSettings::BiomeColors,
+    flgSeaGround    = RenderSettings::SeaGround
   };
 
   typedef struct {
@@ -74,11 +82,16 @@ class MapView : public QWidget {
   void setFlags(int flags);
   int  getFlags() const;
   int  getDepth() const;
+  // snapshot of depth and flags, safe to call from render jobs
+  RenderSettings getRenderSettings() const;
   void addOverlayItem(QSharedPointer<OverlayItem> item);
   void clearOverlayItems();
   void setVisibleOverlayItemTypes(const QSet<QString>& itemTypes);
   QList<QSharedPointer<OverlayItem>> getOverlayItems(const QString& type) const;
 
+  // loading stages of the cache followed by the rendering stages
+  QVector<PipelineStageStats> getPipelineStats();
+
   // public for saving the png
   QString getWorldPath();
 
@@ -89,7 +102,8 @@ class MapView : public QWidget {
  public slots:
   void setDepth(int depth);
   void chunkUpdated(const QSharedPointer<Chunk>& chunk, int x, int z);
-  void redraw();
+  void redraw();  // everything, the regular update only draws what changed
+  void reloadSettings();
 
   // Clears the cache and redraws, causing all chunks to be re-loaded;
   // but keeps the viewport
@@ -122,16 +136,28 @@ class MapView : public QWidget {
 
   RenderParams getCurrentRenderParams() const
   {
-    RenderParams p;
-    p.renderedAt = depth;
-    p.renderedFlags = flags;
-    return p;
+    return RenderParams(depth, flags, lod);
+  }
+
+  // level of detail of the previews rendered while depth or flags change, lod otherwise
+  int getPreviewLod() const
+  {
+    return m_previewing ? std::min(previewLodFactor * lod, int(RenderSettings::MaxLod)) : lod;
+  }
+
+  // what requested chunks are rendered with
+  RenderParams getRequestParams() const
+  {
+    return RenderParams(depth, flags, std::max(lod, getPreviewLod()));
   }
 
   template<class dataT>
   bool redrawNeeded(const dataT& renderedChunk) const
   {
-    return (renderedChunk.renderedFor != getCurrentRenderParams());
+    // chunks record what their rendering depended on, unaffected ones are kept. A preview is enough until
+    // depth and flags rest
+    const RenderParams& rendered = renderedChunk.renderedFor;
+    return !rendered.isValidFor(getCurrentRenderParams()) && !(m_previewing && rendered.isValidFor(getRequestParams()));
   }
 
   void getToolTipMousePos(int mouse_x, int mouse_y);
@@ -145,9 +171,39 @@ class MapView : public QWidget {
   static const int CAVE_DEPTH = 16;  // maximum depth caves are searched in cave mode
   float caveshade[CAVE_DEPTH];
 
-  QReadWriteLock m_readWriteLock;
+  mutable QReadWriteLock m_readWriteLock;
+
+  // region asynchronous loading and rendering jobs are prioritized for (protected by m_readWriteLock)
+  struct PriorityRegion
+  {
+    PriorityRegion() : valid(false) {}
+
+    TopViewPosition center;   // jobs closer to center are executed first
+    QRect chunkGroups;        // jobs for chunk groups outside are dropped
+    bool valid;
+  };
+
+  PriorityRegion m_priorityRegion;
+
+  double getChunkPriority(const ChunkID& cid);
+  void updatePriorityRegion();
+
+  // time until all chunks in the viewport are rendered after the view was moved
+  QElapsedTimer m_viewportTimer;
+  bool m_viewportMeasurementPending;
+  qint64 m_lastViewportCompleteTime;
+
+  void checkViewportComplete();
 
-  int depth;
+  // while the depth slider is dragged or flags are toggled, chunks that have to be scanned again are only
+  // rendered as a coarse preview (see RenderSettings::previewLod). Jobs of superseded settings are dropped,
+  // once the settings rest for previewSettleTime the previews are refined with the latest ones
+  static const int previewLodFactor = 4;
+  static const int previewSettleTime = 200;  // ms
+  QElapsedTimer m_settingsTimer;  // since depth or flags changed
+  bool m_previewing;  // written under m_readWriteLock, render jobs read it
+
+  int depth;  // depth and flags are written under m_readWriteLock, render jobs read them
   double x, z;
   int scale;
 
@@ -156,6 +212,7 @@ class MapView : public QWidget {
   void adjustZoom(double steps);
 
   int flags;
+  int lod;  // level of detail for the zoom, see RenderSettings::lod
   QTimer updateTimer;
   QSharedPointer<ChunkCache> cache;
 
@@ -167,14 +224,35 @@ class MapView : public QWidget {
   using RenderedChunkGroupCacheT = LockGuarded<RenderedChunkGroupCacheUnprotectedT>;
   RenderedChunkGroupCacheT renderedChunkGroupsCache;
 
-  QImage imageChunks;
-  QImage imageOverlays;
-  QImage image_players;
+  // what the frames were composited for: with the same view only the parts that changed are drawn again,
+  // a view moved by whole pixels is scrolled and only the exposed strips are drawn
+  struct CompositedView
+  {
+    bool valid = false;
+    double x = 0.0;
+    double z = 0.0;
+    double zoom = 0.0;
+    QSize size;
+    int depth = 0;
+    int flags = 0;
+    bool depthMap = false;
+    bool blank = false;  // disabled view
+  };
+
+  CompositedView m_composited;  // of the last frame handed to m_frameStage
+  QSet<ChunkGroupID> m_redrawGroups;  // new images or entities since the last composition
+  QVector<QRectF> m_overlayDamage;  // in blocks: players and search results moved since the last composition
+
+  // display settings, read again with reloadSettings()
+  bool m_displayDepthMap;
+  bool m_chunkGroupStatus;
+  bool m_chunkCacheStatus;
+  std::atomic<bool> m_pyramidTilesChanged;  // set by the pyramid stage
   QQueue<std::pair<ChunkID, QSharedPointer<Chunk>>> chunksToRedraw;
   DefinitionManager *dm;
 
   QSet<QString> overlayItemTypes;
-  QMap<QString, QList<QSharedPointer<OverlayItem>>> overlayItems;
+  OverlayItemIndex overlayItems;
   BlockLocation currentLocation;
 
   QPoint lastMousePressPosition;
@@ -188,16 +266,180 @@ class MapView : public QWidget {
 
   ChunkIteratorC chunkRedrawIterator;
 
-  size_t renderChunkAsync(const QSharedPointer<Chunk> &chunk);
+  // the visible chunk groups are only checked for chunks to request again, when the view or the render
+  // parameters changed or a group was invalidated since the last complete check
+  struct RedrawCheck
+  {
+    double x = 0.0;
+    double z = 0.0;
+    double zoom = 0.0;
+    QSize size;
+    RenderParams current;
+    RenderParams request;
+    bool previewing = false;
+    unsigned int renderEpoch = 0;
+
+    bool operator==(const RedrawCheck& other) const
+    {
+      return (x == other.x) && (z == other.z) && (zoom == other.zoom) && (size == other.size) &&
+             (current == other.current) && (request == other.request) && (previewing == other.previewing) &&
+             (renderEpoch == other.renderEpoch);
+    }
+  };
+
+  RedrawCheck m_redrawChecked;  // of the last complete check
+  bool m_redrawCheckPending;    // a group was invalidated or the last check was not complete
+
+  // the chunks of one group are rendered in one job
+  struct RenderItem
+  {
+    QSharedPointer<RenderGroupData> group;  // rendered into its images
+    QVector<ChunkRenderer::GroupItem> chunks;
+  };
+
+  // rendering pipeline: render into chunk group images on thread pool -> update chunk states in GUI thread
+  PipelineStage<RenderItem> m_renderStage;
+  PipelineStage<RenderItem> m_compositeStage;
+
+  // zoomed out beyond the coarsest level of detail the tile pyramid is drawn instead of the chunk groups
+  struct PyramidItem
+  {
+    ChunkGroupID cgid;
+    QSharedPointer<RenderGroupData> group;  // its image is copied into the pyramid
+    bool complete;
+    RenderParams params;
+    QSharedPointer<TileStore> store;  // the images of complete groups are saved, null when stored already
+    quint32 timestamp;
+  };
+
+  TilePyramid m_pyramid;
+  PipelineStage<PyramidItem> m_pyramidStage;
+  QSet<ChunkGroupID> m_pyramidDirty;    // rendered since they were copied into the pyramid
+  QVector<ChunkGroupID> m_worldGroups;  // of the existing region files, sorted by z, then x
+  QHash<ChunkGroupID, quint32> m_groupTimestamps;  // newest chunk of each of m_worldGroups
+
+  // images of earlier sessions: load on thread pool -> show in GUI thread, the chunks are requested afterwards
+  struct StoreItem
+  {
+    ChunkGroupID cgid;
+    QSharedPointer<RenderGroupData> group;
+    QSharedPointer<TileStore> store;
+    RenderParams params;
+    bool found;
+    TileStore::GroupTile tile;
+  };
+
+  QSharedPointer<TileStore> m_tileStore;  // null when disabled
+  PipelineStage<StoreItem> m_storeLoadStage;
+  PipelineStage<StoreItem> m_storeApplyStage;
+
+  // pyramid tiles of the settings: load on thread pool -> insert in GUI thread, changed ones are saved on thread pool
+  struct PyramidStoreItem
+  {
+    QSharedPointer<TileStore> store;
+    RenderParams params;
+    QHash<ChunkGroupID, quint32> groupTimestamps;  // stale tiles aren't loaded, saved tiles record the newest
+    QVector<TilePyramid::Tile> tiles;
+  };
+
+  PipelineStage<PyramidStoreItem> m_pyramidLoadStage;
+  PipelineStage<PyramidStoreItem> m_pyramidApplyStage;
+  PipelineStage<PyramidStoreItem> m_pyramidSaveStage;
+
+  // composition on its own worker thread, one frame at a time: snapshot of what changed in the GUI thread
+  // (redraw__changed()) -> drawn into the layers and the back buffer of m_frames (composeFrame()) ->
+  // the latest frame is shown by paintEvent(). Changes are collected while a frame is composited
+  struct FrameItem
+  {
+    CompositedView view;
+    bool blank = false;
+    QRegion dirty;   // drawn again
+    QPoint shift;    // whole pixels the view moved since the previous frame
+    int pyramidLevel = 0;
+
+    struct Group
+    {
+      ChunkGroupID cgid;
+      QRectF target;
+      QImage image;
+      QSharedPointer<RenderGroupData> overlays;  // depth image and entities, null without entities
+      QVector<std::pair<QRectF, bool>> cachedChunks;  // chunk cache status
+    };
+    QVector<Group> groups;
+    QVector<std::pair<QRectF, QImage>> tiles;  // of the pyramid
+
+    QSet<QString> overlayItemTypes;
+    QVector<QSharedPointer<OverlayItem>> structures;  // in the dirty region
+    QVector<QSharedPointer<OverlayItem>> players;  // and search results
+    QStringList status;  // chunk group status
+  };
+
+  // layers, only used by composeFrame()
+  QImage imageChunks;
+  QImage imageOverlays;
+  QImage image_players;
+
+  TripleFrameBuffer m_frames;
+  QSharedPointer<PriorityThreadPool> m_framePool;  // a single thread, frames don't wait behind render jobs
+  PipelineStage<FrameItem> m_frameStage;
+  std::atomic<bool> m_frameInFlight;
+
+  QRegion composeFrame(FrameItem& item);  // returns the part of the frame that changed
+
+  bool isPyramidZoom() const
+  {
+    return TilePyramid::levelForZoom(zoom) >= TilePyramid::MinLevel;
+  }
+
+  void openWorld();
+  void findWorldGroups();
+  static bool worldGroupBefore(const ChunkGroupID& a, const ChunkGroupID& b);
+  // calls function(cgid) for the world groups in the rectangle until it returns false, returns false then
+  template<typename FunctionT>
+  bool forEachWorldGroupIn(const QRect& chunkGroups, const FunctionT& function) const;
+  void updatePyramid();
+  bool requestStoredGroup(const ChunkGroupID& cgid, const QSharedPointer<RenderGroupData>& group);
+  void applyStoredGroup(StoreItem& item);
+  void loadStoredPyramid();
+  void saveStoredPyramid();
+  static void loadPyramidTiles(PyramidStoreItem& item);
+  static void savePyramidTiles(const PyramidStoreItem& item);
+  void updatePyramidSettings();
+  void redraw__changed();
+  void damageOverlayItems(const QVector<QSharedPointer<OverlayItem>>& items);
+  void redraw__pyramid(const DrawHelper& h, FrameItem& item, int level);
+
+  // incremented when pending render jobs are cancelled
+  unsigned int m_renderEpoch;
+
+  ChunkRenderer::GroupItem createRenderItem(const QSharedPointer<Chunk> &chunk);
+  bool getShadingOnlyItem(const ChunkID& cid, ChunkRenderer::GroupItem& item);
+  void renderingStarted(const RenderItem& item);
+  static ChunkEdgeHeights getEastEdge(RenderedChunkGroupCacheUnprotectedT& groups, const ChunkID& cid, int lod);
+  static void checkEdge(RenderedChunkGroupCacheUnprotectedT& groups, const ChunkID& westCid, const ChunkID& eastCid);
+
+  void cancelPendingRendering();
+
+  bool isRenderingRequested(const RenderGroupData::ChunkState& state) const
+  {
+    return state.flags[RenderStateT::RenderingRequested] && (state.requestEpoch == m_renderEpoch);
+  }
 
   void updateCacheSize(bool onlyIncrease);
 
+  void markChunkNonExisting(const ChunkID& cid);
+
 private slots:
-    void renderingDone(const QSharedPointer<RenderedChunk> chunk);
+    void renderingDone(const QSharedPointer<RenderedChunk> chunk, const QSharedPointer<RenderGroupData> group);
+    void renderingDropped(ChunkID cid);
+    void chunkLoadingDropped(int x, int z);
+
+    void frameComposited(const QRegion& changed);
 
     void regularUpdate();
     void regularUpdata__checkRedraw();
     void regularUpdata__checkRedraw_chunkGroup(const ChunkGroupID& cgid, RenderGroupData& data);
+    void regularUpdata__checkRedraw_pyramid(const QRect& chunkGroups);
 };
 
 #endif  // MAPVIEW_H_
@@ -3,10 +3,12 @@
 
 #include "chunk.h"
 #include "coordinateid.h"
+#include "flatcoordinatehashmap.hpp"
 #include "enumbitset.hpp"
 #include "mapcamera.hpp"
 
 #include <QImage>
+#include <QMutex>
 
 enum class RenderStateT
 {
@@ -16,7 +18,6 @@ enum class RenderStateT
 };
 
 class ChunkGroupCamC;
-class ChunkGroupRendererC;
 
 struct RenderGroupData
 {
@@ -24,21 +25,39 @@ struct RenderGroupData
 
   void clear();
 
-  RenderGroupData& init();
+  // allocates the images for the level of detail, (256/lod)x(256/lod) pixels
+  RenderGroupData& init(int lod);
 
   RenderParams renderedFor;
 
+  // lookup of the images in the TileStore
+  enum class StoreState
+  {
+    NotLoaded,
+    Loading,  // chunks are requested once the stored images are loaded
+    Loaded,
+    Saved     // the images are the stored ones
+  };
+  StoreState storeState;
+  RenderParams storeLookupFor;  // looked up again when the render parameters change
+
+  // render jobs write their chunks directly into the images, hold imageMutex to access them
+  mutable QMutex imageMutex;
   QImage renderedImg;
   QImage depthImg;
   QHash<ChunkID, QSharedPointer<Chunk::EntityMap> > entities;
+  QHash<ChunkID, QSharedPointer<const ChunkGBuffer> > gbuffers;  // to shade again when only shading flags change
 
   struct ChunkState
   {
     RenderParams renderedFor;
     Bitset<RenderStateT, uint8_t> flags;
+    unsigned int requestEpoch;  // RenderingRequested is only valid when set in the current render epoch
+    ChunkEdgeHeights westEdge = unknownEdgeHeights();  // shaded with
+    ChunkEdgeHeights eastEdge = unknownEdgeHeights();  // continued by the east neighbor
   };
 
-  QHash<ChunkID, ChunkState> states;
+  FlatCoordinateHashMap<ChunkID, ChunkState> states;
 };
 
 MapCamera CreateCameraForChunkGroup(const ChunkGroupID& cgid);
@@ -59,8 +78,10 @@ public:
 
   int getHeightAt(const TopViewPosition& midpoint)
   {
+    // the image is smaller than one pixel per block when rendered with a level of detail > 1
+    const int lod = data.depthImg.isNull() ? 1 : ChunkGroupID::getSize().width() / data.depthImg.width();
     const QPointF depthImgPixelF = cam.getPixelFromBlockCoordinates(TopViewPosition(midpoint.x, midpoint.z));
-    const QPoint depthImgPixel(static_cast<int>(depthImgPixelF.x()), static_cast<int>(depthImgPixelF.y()));
+    const QPoint depthImgPixel(static_cast<int>(depthImgPixelF.x()) / lod, static_cast<int>(depthImgPixelF.y()) / lod);
 
     const int highY = data.depthImg.pixel(depthImgPixel) & 0xff;
     return highY;
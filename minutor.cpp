@@ -20,6 +20,8 @@
 #include "searchblockpluginwidget.h"
 #include "prioritythreadpool.h"
 #include "searchresultwidget.h"
+#include "jobmetricsdialog.h"
+#include "resourcegovernor.h"
 
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QAction>
@@ -35,7 +37,10 @@
 #include <QVector3D>
 
 Minutor::Minutor()
-    : threadpool(QSharedPointer<PriorityThreadPool>::create())
+    : threadpool(QSharedPointer<PriorityThreadPool>::create(ResourceGovernor::Instance().getWorkerCount()))
+    , backgroundThreadpool(QSharedPointer<PriorityThreadPool>::create(
+                             ResourceGovernor::Instance().getBackgroundWorkerCount(),
+                             []() { ResourceGovernor::Instance().applyBackgroundPriorityToCurrentThread(); }))
     , cache(QSharedPointer<ChunkCache>::create(threadpool))
     , searchMenu(nullptr)
     , searchEntityAction(nullptr)
@@ -43,6 +48,9 @@ Minutor::Minutor()
     , listStructuresActionsMenu(nullptr)
     , periodicUpdateTimer()
 {
+  ResourceGovernor::Instance().manage(threadpool);
+  ResourceGovernor::Instance().manage(backgroundThreadpool);
+
   mapview = new MapView(threadpool, cache);
   mapview->attach(cache);
   connect(mapview, SIGNAL(hoverTextChanged(QString)),
@@ -61,7 +69,15 @@ Minutor::Minutor()
   settings = new Settings(this);
   connect(settings, SIGNAL(settingsUpdated()),
           this, SLOT(rescanWorlds()));
+  connect(settings, SIGNAL(settingsUpdated()),
+          &ResourceGovernor::Instance(), SLOT(reloadSettings()));
+  connect(settings, SIGNAL(settingsUpdated()),
+          mapview, SLOT(reloadSettings()));
   jumpTo = new JumpTo(this);
+  jobMetrics = new JobMetricsDialog(JobMetricsDialog::PoolListT()
+                                    << qMakePair(QString("foreground"), threadpool)
+                                    << qMakePair(QString("background"), backgroundThreadpool),
+                                    [this]() { return mapview->getPipelineStats(); }, this);
 
   if (settings->autoUpdate) {
     // get time of last update
@@ -193,7 +209,7 @@ void Minutor::savePNG(QString filename, bool autoclose,
                       int w_top, int w_left, int w_bottom, int w_right) {
   progressAutoclose = autoclose;
   if (!filename.isEmpty()) {
-    WorldSave *ws = new WorldSave(filename, mapview,
+    WorldSave *ws = new WorldSave(filename, mapview->getWorldPath(), mapview->getRenderSettings(),
                                   regionChecker, chunkChecker,
                                   w_top, w_left, w_bottom, w_right);
     progress = new QProgressDialog();
@@ -546,6 +562,11 @@ void Minutor::createActions() {
   connect(updatesAct, SIGNAL(triggered()),
           dm,         SLOT(checkForUpdates()));
 
+  jobMetricsAct = new QAction(tr("Job Metrics..."), this);
+  jobMetricsAct->setStatusTip(tr("Show thread pool and pipeline metrics"));
+  connect(jobMetricsAct, SIGNAL(triggered()),
+          jobMetrics,    SLOT(show()));
+
   searchEntityAction = new QAction(tr("Search entity"), this);
   connect(searchEntityAction, SIGNAL(triggered()), this, SLOT(searchEntity()));
 
@@ -669,6 +690,8 @@ void Minutor::createMenus() {
   helpMenu->addSeparator();
   helpMenu->addAction(settingsAct);
   helpMenu->addAction(updatesAct);
+  helpMenu->addSeparator();
+  helpMenu->addAction(jobMetricsAct);
 }
 
 void Minutor::createStatusBar() {
@@ -863,7 +886,7 @@ void Minutor::showProperties(QVariant props)
 
 SearchChunksWidget* Minutor::prepareSearchForm(const QSharedPointer<SearchPluginI>& searchPlugin)
 {
-    SearchChunksWidget* form = new SearchChunksWidget(SearchEntityWidgetInputC(threadpool, cache,
+    SearchChunksWidget* form = new SearchChunksWidget(SearchEntityWidgetInputC(backgroundThreadpool, cache,
                                               [this](){ return mapview->getLocation().getPos3D(); },
                                               searchPlugin
     ));
@@ -31,6 +31,7 @@ class SearchChunksWidget;
 class ChunkCache;
 class SearchPluginI;
 class PriorityThreadPool;
+class JobMetricsDialog;
 
 class Minutor : public QMainWindow {
   Q_OBJECT
@@ -109,6 +110,7 @@ signals:
   void getWorldList();
 
   QSharedPointer<PriorityThreadPool> threadpool;
+  QSharedPointer<PriorityThreadPool> backgroundThreadpool;  // search, threads with lowered priority
   QSharedPointer<ChunkCache> cache;
   MapView *mapview;
   LabelledSlider *depth;
@@ -136,6 +138,7 @@ signals:
   QAction *aboutAct;
   QAction *settingsAct;
   QAction *updatesAct;
+  QAction *jobMetricsAct;
   QAction *jumpToAct;
   QList<QAction*> structureActions;
   QList<QAction*> entityActions;
@@ -147,6 +150,7 @@ signals:
   DefinitionManager *dm;
   Settings *settings;
   JumpTo *jumpTo;
+  JobMetricsDialog *jobMetrics;
   QDir currentWorld;
 
   QSet<QString> overlayItemTypes;
@@ -24,6 +24,7 @@ HEADERS += \
   coordinatehashmap.h \
   coordinateid.h \
   enumbitset.hpp \
+  flatcoordinatehashmap.hpp \
   location.h \
   lockguarded.hpp \
   mapcamera.hpp \
@@ -39,10 +40,18 @@ HEADERS += \
   labelledslider.h \
   biomeidentifier.h \
   blockidentifier.h \
+  blockrendertable.h \
   chunk.h \
   chunkcache.h \
   chunkloader.h \
   chunkrenderer.h \
+  chunkgbuffer.h \
+  rendersettings.h \
+  tilepyramid.h \
+  tilestore.h \
+  tripleframebuffer.h \
+  overlayitemindex.h \
+  columnlayerindex.h \
   definitionmanager.h \
   definitionupdater.h \
   dimensionidentifier.h \
@@ -75,7 +84,14 @@ HEADERS += \
   searchentitypluginwidget.h \
   searchplugininterface.h \
   searchblockpluginwidget.h \
-  threadsafequeue.hpp \
+  workstealingscheduler.hpp \
+  dynamicpriorityqueue.hpp \
+  pipelinestage.hpp \
+  jobgroup.hpp \
+  jobmetrics.h \
+  jobmetricsdialog.h \
+  resourcegovernor.h \
+  regionfilereader.h \
   chunkmath.hpp\
   searchtextwidget.h
 
@@ -83,10 +99,12 @@ SOURCES += \
   labelledslider.cpp \
   biomeidentifier.cpp \
   blockidentifier.cpp \
+  blockrendertable.cpp \
   chunk.cpp \
   chunkcache.cpp \
   chunkloader.cpp \
   chunkrenderer.cpp \
+  columnlayerindex.cpp \
   definitionmanager.cpp \
   definitionupdater.cpp \
   dimensionidentifier.cpp \
@@ -115,7 +133,15 @@ SOURCES += \
   entityevaluator.cpp \
   searchentitypluginwidget.cpp \
   searchblockpluginwidget.cpp \
-  searchtextwidget.cpp
+  searchtextwidget.cpp \
+  jobmetrics.cpp \
+  jobmetricsdialog.cpp \
+  resourcegovernor.cpp \
+  regionfilereader.cpp \
+  tilepyramid.cpp \
+  tilestore.cpp \
+  tripleframebuffer.cpp \
+  overlayitemindex.cpp
 
 RESOURCES = minutor.qrc
 
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Micro benchmarks of hash maps, scheduler and render kernels,
+# built together with the library by minutor_lib_benchmark.pro
+#
+#-------------------------------------------------
+
+QT       += core gui widgets
+
+TARGET = minutor_benchmark
+TEMPLATE = app
+
+CONFIG += c++14 console
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    main_benchmark.cpp
+
+HEADERS +=
@@ -0,0 +1,2 @@
+include(minutor.pro)
+include(minutor_benchmark.pro)
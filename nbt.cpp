@@ -47,11 +47,25 @@ NBT::NBT(const QString level) {
 NBT::NBT(const uchar *chunk) {
   root = &NBT::Null;  // just in case
 
+  const QByteArray nbt = inflateChunk(chunk);
+  if (nbt.isEmpty())
+    return;
+
+  readAll(nbt);
+}
+
+NBT::NBT() {
+  root = &NBT::Null;
+}
+
+QByteArray NBT::inflateChunk(const uchar *chunk) {
+  QByteArray nbt;
+
   // find chunk size
   int length = (chunk[0] << 24) | (chunk[1] << 16) | (chunk[2] << 8) |
       chunk[3];
   if (chunk[4] != 2)  // rfc1950
-    return;
+    return nbt;
 
   z_stream strm;
   static const int CHUNK_SIZE = 8192;
@@ -62,8 +76,6 @@ NBT::NBT(const uchar *chunk) {
   strm.avail_in = length - 1;
   strm.next_in = (Bytef *)chunk + 5;
 
-  QByteArray nbt;
-
   inflateInit(&strm);
   do {
     strm.avail_out = CHUNK_SIZE;
@@ -73,7 +85,15 @@ NBT::NBT(const uchar *chunk) {
   } while (strm.avail_out == 0);
   inflateEnd(&strm);
 
-  readAll(nbt);
+  return nbt;
+}
+
+QSharedPointer<NBT> NBT::fromInflated(const QByteArray &nbt) {
+  QSharedPointer<NBT> result(new NBT());
+  if (!nbt.isEmpty())
+    result->readAll(nbt);
+
+  return result;
 }
 
 void NBT::readAll(const QByteArray& nbt)
@@ -6,6 +6,7 @@ class QString;
 class QByteArray;
 
 #include <QHash>
+#include <QSharedPointer>
 #include <QString>
 #include <QVariant>
 
@@ -138,6 +139,11 @@ class NBT {
   explicit NBT(const uchar *chunk);
   ~NBT();
 
+  // decoding of a region file chunk in separate steps:
+  // inflate the compressed data (length + compression type + data), then parse the inflated data
+  static QByteArray inflateChunk(const uchar *chunk);
+  static QSharedPointer<NBT> fromInflated(const QByteArray &nbt);
+
   bool has(const QString key) const;
   const Tag *at(const QString key) const;
 
@@ -145,6 +151,8 @@ class NBT {
 
   static Tag Null;
  private:
+  NBT();
+
   Tag *root;
 
   void readAll(const QByteArray &nbt);
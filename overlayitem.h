@@ -23,6 +23,8 @@ class OverlayItem {
   virtual void draw(double offsetX, double offsetZ, double scale,
                     QPainter *canvas) const = 0;
   virtual Point midpoint() const = 0;
+  // bounding box, see OverlayItemIndex
+  virtual void getBounds(Point& min, Point& max) const = 0;
   const QString& type() const {return itemType;}
   const QString& display() const { return itemDescription;}
   const QVariant& properties() const { return itemProperties;}
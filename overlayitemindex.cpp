@@ -0,0 +1,110 @@
+#include "./overlayitemindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+int OverlayItemIndex::cellOf(double coordinate)
+{
+  return static_cast<int>(std::floor(coordinate / CellSize));
+}
+
+bool OverlayItemIndex::insert(const QSharedPointer<OverlayItem>& item)
+{
+  TypeIndex& index = m_types[item->type()];
+
+  const OverlayItem::Point mid = item->midpoint();
+  const Midpoint key{mid.x, mid.y, mid.z};
+  if (index.midpoints.contains(key))
+  {
+    return false;
+  }
+  index.midpoints.insert(key);
+
+  OverlayItem::Point min;
+  OverlayItem::Point max;
+  item->getBounds(min, max);
+
+  const int id = index.items.size();
+  index.items.append(item);
+
+  const qint64 cells = qint64(cellOf(max.x) - cellOf(min.x) + 1) * (cellOf(max.z) - cellOf(min.z) + 1);
+  if (cells > MaxItemCells)
+  {
+    index.large.append(id);
+    return true;
+  }
+
+  for (int cz = cellOf(min.z); cz <= cellOf(max.z); cz++)
+  {
+    for (int cx = cellOf(min.x); cx <= cellOf(max.x); cx++)
+    {
+      index.cells[CoordinateID(cx, cz)].append(id);
+    }
+  }
+  return true;
+}
+
+void OverlayItemIndex::clear()
+{
+  m_types.clear();
+}
+
+QList<QSharedPointer<OverlayItem>> OverlayItemIndex::getItems(const QString& type) const
+{
+  return m_types.value(type).items;
+}
+
+QVector<QSharedPointer<OverlayItem>> OverlayItemIndex::query(const QString& type,
+                                                             const OverlayItem::Point& min,
+                                                             const OverlayItem::Point& max) const
+{
+  QVector<QSharedPointer<OverlayItem>> result;
+
+  const auto it = m_types.find(type);
+  if (it == m_types.end())
+  {
+    return result;
+  }
+  const TypeIndex& index = *it;
+
+  // zoomed far out the area covers more cells than there are occupied ones
+  const qint64 cells = qint64(cellOf(max.x) - cellOf(min.x) + 1) * (cellOf(max.z) - cellOf(min.z) + 1);
+  if (cells > index.cells.size())
+  {
+    for (const auto& item: index.items)
+    {
+      if (item->intersects(min, max))
+      {
+        result.append(item);
+      }
+    }
+    return result;
+  }
+
+  QVector<int> candidates = index.large;
+  for (int cz = cellOf(min.z); cz <= cellOf(max.z); cz++)
+  {
+    for (int cx = cellOf(min.x); cx <= cellOf(max.x); cx++)
+    {
+      const auto cell = index.cells.find(CoordinateID(cx, cz));
+      if (cell != index.cells.end())
+      {
+        candidates += *cell;
+      }
+    }
+  }
+
+  // items spanning several cells are found more than once
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  for (int id: candidates)
+  {
+    const auto& item = index.items[id];
+    if (item->intersects(min, max))
+    {
+      result.append(item);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,68 @@
+#ifndef OVERLAYITEMINDEX_H
+#define OVERLAYITEMINDEX_H
+
+#include "./coordinateid.h"
+#include "./overlayitem.h"
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+// Overlay items (structures, villages, ...) of each type in a uniform grid over their bounding boxes in x and z.
+//
+// Drawing and hit testing only look at the cells of the queried area, an item spanning several cells is
+// returned once. Items with the midpoint of an item of the same type already present are skipped.
+class OverlayItemIndex
+{
+public:
+  enum
+  {
+    CellSize = 256,     // blocks
+    MaxItemCells = 64   // items spanning more cells are checked by every query
+  };
+
+  // false when an item of the type with the same midpoint is present already
+  bool insert(const QSharedPointer<OverlayItem>& item);
+
+  void clear();
+
+  // all items of the type, in the order they were inserted
+  QList<QSharedPointer<OverlayItem>> getItems(const QString& type) const;
+
+  // items of the type intersecting the box, in the order they were inserted
+  QVector<QSharedPointer<OverlayItem>> query(const QString& type,
+                                             const OverlayItem::Point& min, const OverlayItem::Point& max) const;
+
+private:
+  struct Midpoint
+  {
+    double x, y, z;
+
+    bool operator==(const Midpoint& other) const
+    {
+      return (x == other.x) && (y == other.y) && (z == other.z);
+    }
+
+    friend uint qHash(const Midpoint& p, uint seed = 0)
+    {
+      return qHash(p.x, seed) ^ (qHash(p.y, seed) * 31) ^ (qHash(p.z, seed) * 961);
+    }
+  };
+
+  struct TypeIndex
+  {
+    QList<QSharedPointer<OverlayItem>> items;
+    QSet<Midpoint> midpoints;
+    QHash<CoordinateID, QVector<int>> cells;  // indices into items
+    QVector<int> large;  // spanning more than MaxItemCells
+  };
+
+  static int cellOf(double coordinate);
+
+  QHash<QString, TypeIndex> m_types;
+};
+
+#endif  // OVERLAYITEMINDEX_H
@@ -0,0 +1,495 @@
+#ifndef PIPELINESTAGE_HPP
+#define PIPELINESTAGE_HPP
+
+#include "prioritythreadpool.h"
+#include "dynamicpriorityqueue.hpp"
+#include "cancellation.hpp"
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QSettings>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct PipelineStageStats
+{
+  QString name;
+  size_t queued;       // waiting in the queue of the stage
+  size_t reserved;     // slots reserved by the previous stage for items in progress there
+  size_t running;
+  size_t capacity;     // 0 -> unbounded
+  size_t parallelism;  // 0 -> processed by owner thread
+  quint64 processed;
+  quint64 dropped;
+  double throughput;   // processed items per second
+  LatencyHistogramSnapshot queueWait;  // time between push and start of processing
+
+  QJsonObject toJson() const
+  {
+    QJsonObject json;
+    json["name"] = name;
+    json["queued"] = static_cast<double>(queued);
+    json["reserved"] = static_cast<double>(reserved);
+    json["running"] = static_cast<double>(running);
+    json["capacity"] = static_cast<double>(capacity);
+    json["parallelism"] = static_cast<double>(parallelism);
+    json["processed"] = static_cast<double>(processed);
+    json["dropped"] = static_cast<double>(dropped);
+    json["throughput"] = throughput;
+    json["queueWait"] = queueWait.toJson();
+    return json;
+  }
+};
+
+// One stage of a processing pipeline.
+//
+// Items wait in a queue until one of at most `parallelism` jobs on the thread pool processes them.
+// Stages with parallelism 0 are processed by their owner thread with processPending() (e.g. GUI thread).
+// The processor returns true to pass the item on to the next stage.
+//
+// Backpressure: the queue of a stage is limited to `capacity` items including slots that are
+// reserved by the previous stage. A stage only starts an item, when it was able to reserve a slot
+// in the next stage for the result. So a slow stage stops the stages in front of it instead of
+// letting intermediate results pile up in memory.
+//
+// Optionally items get a priority (see PriorityThreadPool::PriorityEvaluatorT). The queue is sorted by it,
+// obsolete items are dropped instead of processed. All stages of a pipeline share the cancellation guard
+// of their owner, which has to cancel it before the stages are destroyed.
+template<typename T>
+class PipelineStage
+{
+public:
+  typedef std::function<bool(T&)> ProcessorT;
+  typedef std::function<double(const T&)> PriorityT;
+  typedef std::function<void(T&)> DroppedHandlerT;
+
+  PipelineStage(const QString& name,
+                const QSharedPointer<PriorityThreadPool>& threadPool,
+                PriorityThreadPool::JobPrio jobPrio,
+                JobClass jobClass,
+                const AsyncExecutionCancelGuard& cancelGuard,
+                const ProcessorT& processor)
+    : m_name(name)
+    , m_threadPool(threadPool)
+    , m_jobPrio(jobPrio)
+    , m_jobClass(jobClass)
+    , m_cancelGuard(cancelGuard)
+    , m_processor(processor)
+    , m_queue(ItemPriority{this})
+    , m_keyedGeneration(0)
+    , m_group(JobGroup::create())
+    , m_capacity(0)
+    , m_parallelism(1)
+    , m_next(nullptr)
+    , m_previous(nullptr)
+    , m_reserved(0)
+    , m_running(0)
+    , m_processed(0)
+    , m_dropped(0)
+    , m_throughputProcessed(0)
+    , m_throughput(0.0)
+  {
+    m_throughputTimer.start();
+  }
+
+  PipelineStage(const PipelineStage&) = delete;
+  PipelineStage& operator=(const PipelineStage&) = delete;
+
+  // capacity and parallelism can be overwritten with the settings "pipeline/<name>/capacity" and "pipeline/<name>/parallelism"
+  // defaultParallelism 0: stage is processed by its owner thread, this can not be changed by settings
+  void configure(size_t defaultCapacity, size_t defaultParallelism)
+  {
+    QSettings settings;
+    const QString prefix = "pipeline/" + m_name + "/";
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_capacity = settings.value(prefix + "capacity", static_cast<qulonglong>(defaultCapacity)).toULongLong();
+    if (defaultParallelism > 0)
+    {
+      m_parallelism = std::max<qulonglong>(settings.value(prefix + "parallelism", static_cast<qulonglong>(defaultParallelism)).toULongLong(), 1);
+    }
+    else
+    {
+      m_parallelism = 0;
+    }
+  }
+
+  void setPriority(const PriorityT& priority, const DroppedHandlerT& onDropped)
+  {
+    m_priority = priority;
+    m_onDropped = onDropped;
+  }
+
+  void connectTo(PipelineStage& next)
+  {
+    m_next = &next;
+    next.m_previous = this;
+  }
+
+  // returns false when the queue is full, the item is not taken then
+  bool push(T&& item)
+  {
+    const double key = getPriority(item);
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      if (isFull_unprotected())
+      {
+        return false;
+      }
+      m_queue.push(QueuedItem{std::move(item), ClockT::now()}, key);
+    }
+
+    dispatch();
+    return true;
+  }
+
+  bool isFull() const
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return isFull_unprotected();
+  }
+
+  // for stages with parallelism 0: processes up to maxItems queued items in the calling thread
+  size_t processPending(size_t maxItems)
+  {
+    size_t count = 0;
+    T item;
+    while ((count < maxItems) && popNext(item))
+    {
+      m_processor(item);
+      count++;
+
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_processed++;
+    }
+
+    if ((count > 0) && m_previous)
+    {
+      m_previous->dispatch();  // free slots are available now
+    }
+
+    return count;
+  }
+
+  // for stages with parallelism > 0: waits until all queued items are processed, before the jobs are cancelled
+  void waitForDone()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_queue.empty() && (m_running == 0); });
+  }
+
+  // removes all queued items without processing them, results of running jobs are discarded
+  void clear()
+  {
+    JobGroupPtr canceledGroup;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_queue.clear();
+      canceledGroup = m_group;
+      m_group = JobGroup::create();
+    }
+
+    m_threadPool->cancelGroup(canceledGroup);  // no need to wait, results are dropped
+
+    if (m_previous)
+    {
+      m_previous->dispatch();
+    }
+  }
+
+  // throughput is averaged over intervals of at least one second
+  PipelineStageStats getStats()
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    const qint64 elapsed = m_throughputTimer.elapsed();
+    if (elapsed >= 1000)
+    {
+      m_throughput = (m_processed - m_throughputProcessed) * 1000.0 / elapsed;
+      m_throughputProcessed = m_processed;
+      m_throughputTimer.restart();
+    }
+
+    PipelineStageStats stats;
+    stats.name = m_name;
+    stats.queued = m_queue.size();
+    stats.reserved = m_reserved;
+    stats.running = m_running;
+    stats.capacity = m_capacity;
+    stats.parallelism = m_parallelism;
+    stats.processed = m_processed;
+    stats.dropped = m_dropped;
+    stats.throughput = m_throughput;
+    stats.queueWait = m_queueWait.snapshot();
+    return stats;
+  }
+
+private:
+  typedef ThreadPoolMetrics::ClockT ClockT;
+
+  struct QueuedItem
+  {
+    T item;
+    ClockT::time_point queuedAt;
+  };
+
+  // the priority depends on the item itself, rekeying evaluates copies of the items
+  struct ItemPriority
+  {
+    typedef T EvaluatorT;
+
+    const PipelineStage* stage;
+
+    EvaluatorT evaluatorOf(const QueuedItem& queued) const
+    {
+      return queued.item;
+    }
+
+    double operator()(const QueuedItem& queued) const
+    {
+      return stage->getPriority(queued.item);
+    }
+
+    double operator()(const T& item) const
+    {
+      return stage->getPriority(item);
+    }
+  };
+
+  typedef DynamicPriorityQueue<QueuedItem, ItemPriority> QueueT;
+
+  const QString m_name;
+  QSharedPointer<PriorityThreadPool> m_threadPool;
+  const PriorityThreadPool::JobPrio m_jobPrio;
+  const JobClass m_jobClass;
+  const AsyncExecutionCancelGuard& m_cancelGuard;
+  const ProcessorT m_processor;
+  PriorityT m_priority;
+  DroppedHandlerT m_onDropped;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_done;  // a job finished
+  QueueT m_queue;
+  std::atomic<size_t> m_keyedGeneration;  // priority generation of the last rekey
+  JobGroupPtr m_group;  // jobs started since last clear()
+  size_t m_capacity;
+  size_t m_parallelism;
+  PipelineStage* m_next;
+  PipelineStage* m_previous;
+  size_t m_reserved;
+  size_t m_running;
+  quint64 m_processed;
+  quint64 m_dropped;
+  LatencyHistogram m_queueWait;
+
+  QElapsedTimer m_throughputTimer;
+  quint64 m_throughputProcessed;
+  double m_throughput;
+
+  double getPriority(const T& item) const
+  {
+    return m_priority ? m_priority(item) : 0.0;
+  }
+
+  // priorities are evaluated without holding m_mutex, the evaluators may lock other things
+  void rekey()
+  {
+    if (!m_priority)
+    {
+      return;  // FIFO
+    }
+
+    const size_t generation = m_threadPool->getPriorityGeneration();
+    if (m_keyedGeneration.exchange(generation) != generation)
+    {
+      m_queue.rekey(m_mutex, generation);
+    }
+  }
+
+  bool isFull_unprotected() const
+  {
+    return (m_capacity > 0) && ((m_queue.size() + m_reserved) >= m_capacity);
+  }
+
+  bool tryReserve()
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (isFull_unprotected())
+    {
+      return false;
+    }
+    m_reserved++;
+    return true;
+  }
+
+  void releaseReservation()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_reserved--;
+    }
+
+    if (m_previous)
+    {
+      m_previous->dispatch();
+    }
+  }
+
+  void pushReserved(T&& item)
+  {
+    const double key = getPriority(item);
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_reserved--;
+      m_queue.push(QueuedItem{std::move(item), ClockT::now()}, key);
+    }
+
+    dispatch();
+  }
+
+  bool popNext(T& item)
+  {
+    rekey();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    QueuedItem queued;
+    if (!m_queue.pop(queued))
+    {
+      return false;
+    }
+    m_queueWait.record(ClockT::now() - queued.queuedAt);
+    item = std::move(queued.item);
+    return true;
+  }
+
+  // starts processing of queued items as far as parallelism and the next stage allow it
+  void dispatch()
+  {
+    std::vector<T> toStart;
+    std::vector<T> toDrop;
+
+    rekey();
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      if (m_parallelism == 0)
+      {
+        return;  // processed by owner
+      }
+
+      QueuedItem queued;
+      double key;
+      while ((m_running < m_parallelism) && m_queue.pop(queued, key))
+      {
+        if (key < 0.0)
+        {
+          m_dropped++;
+          toDrop.push_back(std::move(queued.item));
+          continue;
+        }
+
+        if (m_next && !m_next->tryReserve())
+        {
+          m_queue.push(std::move(queued), key);
+          break;
+        }
+
+        m_running++;
+        m_queueWait.record(ClockT::now() - queued.queuedAt);
+        toStart.push_back(std::move(queued.item));
+      }
+    }
+
+    for (auto& item: toDrop)
+    {
+      if (m_onDropped)
+      {
+        m_onDropped(item);
+      }
+    }
+
+    JobGroupPtr group;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      group = m_group;
+    }
+
+    for (auto& item: toStart)
+    {
+      enqueueJob(std::move(item), group);
+    }
+
+    if (m_previous && (!toStart.empty() || !toDrop.empty()))
+    {
+      m_previous->dispatch();  // free slots are available now
+    }
+  }
+
+  void enqueueJob(T&& item, const JobGroupPtr& group)
+  {
+    const auto cancelToken = m_cancelGuard.getToken();
+    auto sharedItem = QSharedPointer<T>::create(std::move(item));
+
+    m_threadPool->enqueueJob([this, sharedItem, cancelToken, group]() {
+      if (cancelToken.isCanceled())
+        return;
+
+      const bool forward = m_processor(*sharedItem) && !group->isCanceled();
+      if (m_next)
+      {
+        if (forward)
+        {
+          m_next->pushReserved(std::move(*sharedItem));
+        }
+        else
+        {
+          m_next->releaseReservation();
+        }
+      }
+
+      finishJob(false);
+    }, m_jobPrio, [this, sharedItem, cancelToken]() {
+      return cancelToken.isCanceled() ? -1.0 : getPriority(*sharedItem);
+    }, [this, sharedItem, cancelToken, group]() {
+      if (cancelToken.isCanceled())
+        return;
+
+      if (m_onDropped && !group->isCanceled())
+      {
+        m_onDropped(*sharedItem);
+      }
+      if (m_next)
+      {
+        m_next->releaseReservation();
+      }
+
+      finishJob(true);
+    }, group, m_jobClass);
+  }
+
+  void finishJob(bool dropped)
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_running--;
+      if (dropped)
+      {
+        m_dropped++;
+      }
+      else
+      {
+        m_processed++;
+      }
+    }
+    m_done.notify_all();
+
+    dispatch();
+  }
+};
+
+#endif // PIPELINESTAGE_HPP
@@ -1,23 +1,54 @@
 #include "prioritythreadpool.h"
 
+#include <algorithm>
 #include <future>
+#include <list>
+#include <thread>
 
 class PriorityThreadPool::HiddenImplementationC
 {
 public:
-  HiddenImplementationC(PriorityThreadPool& parent)
+  HiddenImplementationC(PriorityThreadPool& parent, size_t numberOfThreads, const JobT& threadInit)
     : m_parent(parent)
+    , m_queue(numberOfThreads)
+    , m_metrics(numberOfThreads)
   {
-    const size_t numberOfCpuCores = std::thread::hardware_concurrency();
-
-    for (size_t i = 0; i < numberOfCpuCores; i++)
+    for (size_t i = 0; i < numberOfThreads; i++)
     {
-       m_futures.push_back(std::async(std::launch::async, [this]() {
-        PriorityThreadPool::JobT job;
-        while (m_queue.pop(job))
+       m_futures.push_back(std::async(std::launch::async, [this, i, threadInit]() {
+        if (threadInit)
         {
-            job();
-            job = PriorityThreadPool::JobT(); // directly delete functor after execution and before blocking for wait.
+          threadInit();
+        }
+        m_queue.registerCurrentThreadAsWorker(i);
+        PriorityThreadPool::ScheduledJob scheduled;
+        while (m_queue.pop(i, scheduled))
+        {
+            const auto startTime = ThreadPoolMetrics::ClockT::now();
+
+            const bool started = !scheduled.group || scheduled.group->tryStartJob();
+            if (started && (scheduled.currentPriority() >= 0.0))
+            {
+              m_metrics.jobStarted(scheduled.jobClass, startTime - scheduled.enqueuedAt);
+              scheduled.job();
+              m_metrics.jobFinished(scheduled.jobClass, ThreadPoolMetrics::ClockT::now() - startTime);
+            }
+            else
+            {
+              m_metrics.jobCancelled(scheduled.jobClass);
+              if (scheduled.onDropped)
+              {
+                scheduled.onDropped();
+              }
+            }
+
+            if (started && scheduled.group)
+            {
+              scheduled.group->jobFinished();
+            }
+            scheduled = PriorityThreadPool::ScheduledJob(); // directly delete functors after execution and before blocking for wait.
+
+            m_metrics.workerBusy(i, ThreadPoolMetrics::ClockT::now() - startTime);
         }
       }));
     }
@@ -32,14 +63,23 @@ public:
     }
   }
 
+  static size_t defaultNumberOfThreads()
+  {
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
   PriorityThreadPool& m_parent;
   PriorityThreadPool::QueueType m_queue;
+  ThreadPoolMetrics m_metrics;
   std::list<std::future<void> > m_futures;
 };
 
-PriorityThreadPool::PriorityThreadPool()
-  : m_impl(QSharedPointer<HiddenImplementationC>::create(*this))
+PriorityThreadPool::PriorityThreadPool(size_t numberOfThreads, const JobT& threadInit)
+  : m_impl(QSharedPointer<HiddenImplementationC>::create(*this,
+             (numberOfThreads > 0) ? numberOfThreads : HiddenImplementationC::defaultNumberOfThreads(),
+             threadInit))
   , m_queue(m_impl->m_queue)
+  , m_metrics(m_impl->m_metrics)
 {}
 
 size_t PriorityThreadPool::getNumberOfThreads() const
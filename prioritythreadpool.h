@@ -1,16 +1,26 @@
 #ifndef ASYNCTASKPROCESSORBASE_HPP
 #define ASYNCTASKPROCESSORBASE_HPP
 
-#include "threadsafequeue.hpp"
+#include "workstealingscheduler.hpp"
+#include "jobgroup.hpp"
+#include "jobmetrics.h"
 
 #include <QSharedPointer>
 
+#include <functional>
+
 class PriorityThreadPool
 {
 public:
     typedef std::function<void()> JobT;
 
-    PriorityThreadPool();
+    // returns the current priority of a queued job: smaller values are executed first,
+    // a negative value marks the job as obsolete -> it is dropped without being executed
+    typedef std::function<double()> PriorityEvaluatorT;
+
+    // numberOfThreads == 0 -> one thread per cpu core
+    // threadInit is called by each worker thread before it starts to process jobs (e.g. to lower its priority)
+    explicit PriorityThreadPool(size_t numberOfThreads = 0, const JobT& threadInit = JobT());
 
     enum class JobPrio
     {
@@ -18,9 +28,48 @@ public:
       high
     };
 
-    size_t enqueueJob(const JobT& job, JobPrio prio = JobPrio::low)
+    // jobs enqueued from within a running job are kept local to that worker thread
+    // until an idle worker steals them
+    // jobClass only selects the metrics the job is accounted in
+    size_t enqueueJob(const JobT& job, JobPrio prio = JobPrio::low, JobClass jobClass = JobClass::other)
+    {
+      return enqueueJob(job, prio, PriorityEvaluatorT(), JobT(), JobGroupPtr(), jobClass);
+    }
+
+    // the job is discarded, when group is cancelled before the job was started
+    size_t enqueueJob(const JobT& job, JobPrio prio, const JobGroupPtr& group, JobClass jobClass = JobClass::other)
+    {
+      return enqueueJob(job, prio, PriorityEvaluatorT(), JobT(), group, jobClass);
+    }
+
+    // onDropped is called instead of job, when the job became obsolete or its group was cancelled before it was started
+    size_t enqueueJob(const JobT& job, JobPrio prio, const PriorityEvaluatorT& priority, const JobT& onDropped = JobT(),
+                      const JobGroupPtr& group = JobGroupPtr(), JobClass jobClass = JobClass::other)
+    {
+      m_metrics.jobEnqueued(jobClass);
+      return m_queue.push(ScheduledJob{job, priority, onDropped, group, jobClass, ThreadPoolMetrics::ClockT::now()},
+                          (prio == JobPrio::low) ? 1 : 0);
+    }
+
+    // O(1) for the caller: queued jobs of the group are discarded by the workers (first),
+    // the returned future becomes ready when running jobs of the group have finished
+    std::shared_future<void> cancelGroup(const JobGroupPtr& group)
+    {
+      auto future = group->cancel();
+      m_queue.reevaluatePriorities();
+      return future;
+    }
+
+    // to be called when the result of the priority evaluators changed (e.g. view was moved)
+    void reevaluatePriorities()
+    {
+      m_queue.reevaluatePriorities();
+    }
+
+    // changes with every call of reevaluatePriorities(), for queues outside of the pool that use the same evaluators
+    size_t getPriorityGeneration() const
     {
-      return m_queue.push(job, (prio == JobPrio::low) ? 1 : 0);
+      return m_queue.getPriorityGeneration();
     }
 
     size_t getQueueLength() const
@@ -30,12 +79,84 @@ public:
 
     size_t getNumberOfThreads() const;
 
+    // threads above the limit stay idle, their local jobs are taken over by the others
+    void setActiveThreadLimit(size_t limit)
+    {
+      m_queue.setActiveWorkerLimit(limit);
+    }
+
+    size_t getActiveThreadLimit() const
+    {
+      return m_queue.getActiveWorkerLimit();
+    }
+
+    ThreadPoolMetricsSnapshot getMetrics() const
+    {
+      return m_metrics.snapshot();
+    }
+
+    void resetMetrics()
+    {
+      m_metrics.reset();
+    }
+
 private:
     class HiddenImplementationC;
-    using QueueType = ThreadSafePriorityQueue<JobT>;
+
+    struct ScheduledJob
+    {
+      JobT job;
+      PriorityEvaluatorT priority;
+      JobT onDropped;
+      JobGroupPtr group;
+      JobClass jobClass;
+      ThreadPoolMetrics::ClockT::time_point enqueuedAt;
+
+      double currentPriority() const
+      {
+        return evaluatePriority(group, priority);
+      }
+
+      static double evaluatePriority(const JobGroupPtr& group, const PriorityEvaluatorT& priority)
+      {
+        if (group && group->isCanceled())
+        {
+          return -1.0;  // sorts them to the front of the queue -> discarded soon
+        }
+        return priority ? priority() : 0.0;
+      }
+
+      struct Key
+      {
+        // what the priority depends on, copied instead of the whole job when the queue is rekeyed
+        struct EvaluatorT
+        {
+          JobGroupPtr group;
+          PriorityEvaluatorT priority;
+        };
+
+        EvaluatorT evaluatorOf(const ScheduledJob& scheduled) const
+        {
+          return EvaluatorT{scheduled.group, scheduled.priority};
+        }
+
+        double operator()(const ScheduledJob& scheduled) const
+        {
+          return scheduled.currentPriority();
+        }
+
+        double operator()(const EvaluatorT& evaluator) const
+        {
+          return evaluatePriority(evaluator.group, evaluator.priority);
+        }
+      };
+    };
+
+    using QueueType = WorkStealingScheduler<ScheduledJob, ScheduledJob::Key>;
 
     QSharedPointer<HiddenImplementationC> m_impl;
     QueueType& m_queue;
+    ThreadPoolMetrics& m_metrics;
 };
 
 #endif // ASYNCTASKPROCESSORBASE_HPP
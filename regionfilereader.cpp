@@ -0,0 +1,223 @@
+#include "./regionfilereader.h"
+
+#include <QtGlobal>
+
+#include <atomic>
+
+#if defined(Q_OS_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<quint64> s_bytesRead[RegionReadModeCount];
+static std::atomic<quint64> s_chunksRead[RegionReadModeCount];
+
+QString toString(RegionReadMode mode)
+{
+  switch (mode)
+  {
+    case RegionReadMode::dropAfterRead:
+      return "dropAfterRead";
+    case RegionReadMode::direct:
+      return "direct";
+    case RegionReadMode::cached:
+      break;
+  }
+  return "cached";
+}
+
+QJsonObject RegionReadStats::toJson() const
+{
+  QJsonObject json;
+  for (size_t i = 0; i < RegionReadModeCount; i++)
+  {
+    QJsonObject mode;
+    mode["bytes"] = static_cast<double>(bytes[i]);
+    mode["chunks"] = static_cast<double>(chunks[i]);
+    json[toString(static_cast<RegionReadMode>(i))] = mode;
+  }
+  return json;
+}
+
+RegionFileReader::RegionFileReader(const QString& filename, RegionReadMode mode)
+  : m_mode(mode)
+  , m_file(filename)
+  , m_directFd(-1)
+  , m_headerRead(false)
+{
+#if defined(Q_OS_LINUX)
+  if (m_mode == RegionReadMode::direct)
+  {
+    m_directFd = ::open(QFile::encodeName(filename).constData(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (m_directFd >= 0)
+    {
+      return;
+    }
+    m_mode = RegionReadMode::dropAfterRead;  // e.g. tmpfs does not support O_DIRECT
+  }
+#else
+  m_mode = RegionReadMode::cached;
+#endif
+
+  m_file.open(QIODevice::ReadOnly);
+}
+
+RegionFileReader::~RegionFileReader()
+{
+#if defined(Q_OS_LINUX)
+  if (m_directFd >= 0)
+  {
+    ::close(m_directFd);
+  }
+#endif
+}
+
+bool RegionFileReader::isOpen() const
+{
+  return (m_directFd >= 0) || m_file.isOpen();
+}
+
+QByteArray RegionFileReader::readChunk(int localX, int localZ)
+{
+  if (!isOpen())  // no chunks in this region
+  {
+    return QByteArray();
+  }
+
+  if (!m_headerRead)
+  {
+    // read once and kept in m_header, it is small and needed for every chunk of the region
+    m_headerRead = true;
+    if (!readSectors(0, 1, m_header))
+    {
+      m_header.clear();
+    }
+  }
+
+  if (m_header.size() < SectorSize)
+  {
+    return QByteArray();
+  }
+
+  const uchar *header = reinterpret_cast<const uchar*>(m_header.constData());
+  const int offset = 4 * ((localX & 31) + (localZ & 31) * 32);
+  const int coffset = (header[offset] << 16) | (header[offset + 1] << 8) | header[offset + 2];
+  const int numSectors = header[offset + 3];
+
+  if (coffset == 0)  // no chunk
+  {
+    return QByteArray();
+  }
+
+  QByteArray raw;
+  const bool ok = readSectors(coffset, numSectors, raw);
+
+  if (m_mode == RegionReadMode::dropAfterRead)
+  {
+    dropPages(static_cast<qint64>(coffset) * SectorSize, static_cast<qint64>(numSectors) * SectorSize);
+  }
+
+  if (!ok || (raw.size() < 5))  // at least length and compression type
+  {
+    return QByteArray();
+  }
+
+  s_chunksRead[static_cast<size_t>(m_mode)]++;
+  return raw;
+}
+
+QVector<quint32> RegionFileReader::readTimestamps(const QString& filename)
+{
+  // second sector of the header, one big endian value per chunk
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly) || !file.seek(SectorSize))
+  {
+    return QVector<quint32>();
+  }
+
+  const QByteArray table = file.read(SectorSize);
+  if (table.size() < SectorSize)
+  {
+    return QVector<quint32>();
+  }
+
+  s_bytesRead[static_cast<size_t>(RegionReadMode::cached)] += SectorSize;
+
+  const uchar *data = reinterpret_cast<const uchar*>(table.constData());
+  QVector<quint32> timestamps(32 * 32);
+  for (int i = 0; i < timestamps.size(); i++)
+  {
+    timestamps[i] = (quint32(data[4 * i]) << 24) | (quint32(data[4 * i + 1]) << 16) |
+                    (quint32(data[4 * i + 2]) << 8) | quint32(data[4 * i + 3]);
+  }
+  return timestamps;
+}
+
+RegionReadStats RegionFileReader::getStats()
+{
+  RegionReadStats stats;
+  for (size_t i = 0; i < RegionReadModeCount; i++)
+  {
+    stats.bytes[i] = s_bytesRead[i];
+    stats.chunks[i] = s_chunksRead[i];
+  }
+  return stats;
+}
+
+bool RegionFileReader::readSectors(qint64 firstSector, int numSectors, QByteArray& data)
+{
+  const qint64 offset = firstSector * SectorSize;
+  const qint64 length = static_cast<qint64>(numSectors) * SectorSize;
+
+#if defined(Q_OS_LINUX)
+  if (m_directFd >= 0)
+  {
+    // O_DIRECT needs buffer, offset and length aligned to the logical block size, sectors of region files are
+    char *buffer = static_cast<char*>(qMallocAligned(length, SectorSize));
+    if (buffer == nullptr)
+    {
+      return false;
+    }
+
+    qint64 done = 0;
+    while (done < length)
+    {
+      const ssize_t result = ::pread(m_directFd, buffer + done, length - done, offset + done);
+      if (result < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (result <= 0)
+      {
+        break;  // error or end of file
+      }
+      done += result;
+    }
+
+    data = QByteArray(buffer, done);
+    qFreeAligned(buffer);
+    s_bytesRead[static_cast<size_t>(m_mode)] += done;
+    return done > 0;
+  }
+#endif
+
+  if (!m_file.seek(offset))
+  {
+    return false;
+  }
+
+  data = m_file.read(length);
+  s_bytesRead[static_cast<size_t>(m_mode)] += data.size();
+  return !data.isEmpty();
+}
+
+void RegionFileReader::dropPages(qint64 offset, qint64 length)
+{
+#if defined(Q_OS_LINUX)
+  ::posix_fadvise(m_file.handle(), offset, length, POSIX_FADV_DONTNEED);
+#else
+  Q_UNUSED(offset);
+  Q_UNUSED(length);
+#endif
+}
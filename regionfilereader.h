@@ -0,0 +1,73 @@
+#ifndef REGIONFILEREADER_H
+#define REGIONFILEREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+// how chunk data is read from region files
+enum class RegionReadMode
+{
+  cached,          // normal reads through the page cache (viewport)
+  dropAfterRead,   // bulk scans: pages of a chunk are dropped from the page cache after reading it
+  direct           // bulk scans: O_DIRECT into aligned buffers, the page cache is not touched at all
+};
+
+static const size_t RegionReadModeCount = 3;
+
+QString toString(RegionReadMode mode);
+
+struct RegionReadStats
+{
+  quint64 bytes[RegionReadModeCount];
+  quint64 chunks[RegionReadModeCount];
+
+  QJsonObject toJson() const;
+};
+
+// Reads chunks from one region file (.mca), the header is read once per reader.
+//
+// Scan modes only work on Linux, other systems read with mode cached.
+// When the file system does not support O_DIRECT, dropAfterRead is used instead.
+class RegionFileReader
+{
+public:
+  static const int SectorSize = 4096;
+
+  RegionFileReader(const QString& filename, RegionReadMode mode);
+  ~RegionFileReader();
+
+  RegionFileReader(const RegionFileReader&) = delete;
+  RegionFileReader& operator=(const RegionFileReader&) = delete;
+
+  bool isOpen() const;
+
+  RegionReadMode getMode() const
+  {
+    return m_mode;
+  }
+
+  // local coordinates 0..31 inside the region, returns the compressed chunk including its 5 byte header
+  // or an empty array when the chunk does not exist
+  QByteArray readChunk(int localX, int localZ);
+
+  // last save of every chunk in seconds since epoch, index localX + localZ * 32, empty when the file can't be read
+  static QVector<quint32> readTimestamps(const QString& filename);
+
+  // bytes read in each mode since program start
+  static RegionReadStats getStats();
+
+private:
+  RegionReadMode m_mode;
+  QFile m_file;
+  int m_directFd;
+  QByteArray m_header;
+  bool m_headerRead;
+
+  bool readSectors(qint64 firstSector, int numSectors, QByteArray& data);
+  void dropPages(qint64 offset, qint64 length);
+};
+
+#endif  // REGIONFILEREADER_H
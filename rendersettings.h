@@ -0,0 +1,72 @@
+#ifndef RENDERSETTINGS_H
+#define RENDERSETTINGS_H
+
+#include "./chunk.h"
+
+// Everything the chunk renderer needs to know about how a map is drawn.
+//
+// A plain value, MapView hands a snapshot of its current settings to every render job. Exports, command line
+// tools and benchmarks build their own without a view.
+struct RenderSettings
+{
+  enum Flags
+  {
+    Lighting     = 1 << 0,
+    MobSpawn     = 1 << 1,
+    CaveMode     = 1 << 2,
+    DepthShading = 1 << 3,
+    ShowEntities = 1 << 4,  // overlays only, the chunk images don't depend on it
+    SingleLayer  = 1 << 5,
+    BiomeColors  = 1 << 6,
+    SeaGround    = 1 << 7
+  };
+
+  enum
+  {
+    MaxLod = 8
+  };
+
+  RenderSettings(int depth_ = 255, int flags_ = 0, int lod_ = 1, int previewLod_ = 1)
+    : depth(depth_)
+    , flags(flags_)
+    , lod(lod_)
+    , previewLod(previewLod_)
+  {}
+
+  // coarsest level of detail whose pixels still cover at least one screen pixel at the zoom (pixels per block)
+  static int lodForZoom(double zoom)
+  {
+    int lod = 1;
+    while ((lod < MaxLod) && (zoom * lod * 2 <= 1.0))
+    {
+      lod *= 2;
+    }
+    return lod;
+  }
+
+  // parameters a rendering with these settings has to be valid for
+  RenderParams toParams() const
+  {
+    return RenderParams(depth, flags, lod);
+  }
+
+  bool operator==(const RenderSettings& other) const
+  {
+    return (depth == other.depth) && (flags == other.flags) && (lod == other.lod) && (previewLod == other.previewLod);
+  }
+
+  bool operator!=(const RenderSettings& other) const
+  {
+    return !(operator==(other));
+  }
+
+  int depth;  // highest block shown
+  int flags;  // combination of Flags
+  int lod;    // level of detail: one pixel for every lod-th column in both directions, 1, 2, 4 or MaxLod
+
+  // > lod: chunks that have to be scanned again only get a quick preview, every previewLod-th column is
+  // scanned and its pixel repeated. Their RenderParams have the previewLod, so they are refined later.
+  int previewLod;
+};
+
+#endif  // RENDERSETTINGS_H
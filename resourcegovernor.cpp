@@ -0,0 +1,262 @@
+#include "./resourcegovernor.h"
+#include "./prioritythreadpool.h"
+
+#include <QFile>
+#include <QSettings>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(Q_OS_LINUX)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+// above this fraction of I/O wait the number of running threads is reduced step by step,
+// below the lower threshold it is increased again
+static const double IoWaitHigh = 0.20;
+static const double IoWaitLow = 0.05;
+static const int AdaptIntervalMs = 2000;
+
+TokenBucket::TokenBucket()
+  : m_rate(0)
+  , m_tokens(0.0)
+  , m_lastRefill(ClockT::now())
+{}
+
+void TokenBucket::setRate(qint64 bytesPerSecond)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_rate = std::max<qint64>(bytesPerSecond, 0);
+  m_tokens = std::min<double>(m_tokens, m_rate);
+  m_lastRefill = ClockT::now();
+}
+
+void TokenBucket::acquire(qint64 bytes)
+{
+  std::chrono::duration<double> delay(0.0);
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_rate == 0)
+    {
+      return;
+    }
+
+    // refill, the bucket holds at most one second of traffic
+    const auto now = ClockT::now();
+    m_tokens = std::min<double>(m_tokens + std::chrono::duration<double>(now - m_lastRefill).count() * m_rate, m_rate);
+    m_lastRefill = now;
+
+    // go into debt and let the caller sleep until it is paid back
+    m_tokens -= bytes;
+    if (m_tokens < 0.0)
+    {
+      delay = std::chrono::duration<double>(-m_tokens / m_rate);
+    }
+  }
+
+  if (delay.count() > 0.0)
+  {
+    std::this_thread::sleep_for(delay);
+  }
+}
+
+ResourceGovernor& ResourceGovernor::Instance()
+{
+  static ResourceGovernor singleton;
+  return singleton;
+}
+
+ResourceGovernor::ResourceGovernor()
+  : m_workers(1)
+  , m_cpuSharePercent(100)
+  , m_backgroundPriority(BackgroundPriority::normal)
+  , m_adaptive(false)
+  , m_scanDirectIo(false)
+  , m_adaptiveScale(1.0)
+  , m_lastCpuTotal(0)
+  , m_lastCpuIoWait(0)
+  , m_ioWait(-1.0)
+{
+  m_adaptTimer.setInterval(AdaptIntervalMs);
+  connect(&m_adaptTimer, SIGNAL(timeout()), this, SLOT(adapt()));
+
+  reloadSettings();
+}
+
+void ResourceGovernor::reloadSettings()
+{
+  QSettings settings;
+
+  const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  const size_t workers = settings.value("resources/workers", 0).toUInt();
+  m_workers = (workers > 0) ? workers : cores;
+  m_cpuSharePercent = std::max(std::min(settings.value("resources/cpushare", 100).toInt(), 100), 1);
+  m_backgroundPriority = static_cast<BackgroundPriority>(
+        std::max(std::min(settings.value("resources/backgroundpriority", 0).toInt(), 2), 0));
+  m_adaptive = settings.value("resources/adaptive", false).toBool();
+  m_scanDirectIo = settings.value("resources/scandirectio", false).toBool();
+
+  const qint64 ioLimitMB = settings.value("resources/backgroundiolimit", 0).toLongLong();
+  m_backgroundIo.setRate(std::max<qint64>(ioLimitMB, 0) * 1024 * 1024);
+
+  if (m_adaptive)
+  {
+    m_adaptTimer.start();
+  }
+  else
+  {
+    m_adaptTimer.stop();
+    m_adaptiveScale = 1.0;
+  }
+
+  applyLimits();
+}
+
+size_t ResourceGovernor::getWorkerCount() const
+{
+  return m_workers;
+}
+
+size_t ResourceGovernor::getBackgroundWorkerCount() const
+{
+  return std::max<size_t>(m_workers / 2, 1);
+}
+
+void ResourceGovernor::manage(const QSharedPointer<PriorityThreadPool>& pool)
+{
+  m_pools.append(pool.toWeakRef());
+  applyLimits();
+}
+
+void ResourceGovernor::applyBackgroundPriorityToCurrentThread() const
+{
+#if defined(Q_OS_LINUX)
+  switch (m_backgroundPriority)
+  {
+    case BackgroundPriority::idle:
+    {
+      struct sched_param param;
+      param.sched_priority = 0;
+      if (sched_setscheduler(0, SCHED_IDLE, &param) == 0)
+      {
+        break;
+      }
+      // not supported by the kernel -> use the lowest nice level
+      setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+      break;
+    }
+    case BackgroundPriority::nice:
+      // on Linux the nice level is a property of the thread
+      setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+      break;
+    case BackgroundPriority::normal:
+      break;
+  }
+#elif defined(Q_OS_WIN)
+  switch (m_backgroundPriority)
+  {
+    case BackgroundPriority::idle:
+      SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+      break;
+    case BackgroundPriority::nice:
+      SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+      break;
+    case BackgroundPriority::normal:
+      break;
+  }
+#endif
+}
+
+void ResourceGovernor::throttleBackgroundIo(qint64 bytes)
+{
+  m_backgroundIo.acquire(bytes);
+}
+
+RegionReadMode ResourceGovernor::getScanReadMode() const
+{
+  return m_scanDirectIo ? RegionReadMode::direct : RegionReadMode::dropAfterRead;
+}
+
+double ResourceGovernor::getIoWait() const
+{
+  return m_ioWait;
+}
+
+void ResourceGovernor::adapt()
+{
+  if (!sampleIoWait())
+  {
+    return;
+  }
+
+  if (m_ioWait > IoWaitHigh)
+  {
+    m_adaptiveScale = m_adaptiveScale * 0.75;
+  }
+  else if (m_ioWait < IoWaitLow)
+  {
+    m_adaptiveScale = std::min(m_adaptiveScale + 0.125, 1.0);
+  }
+
+  applyLimits();
+}
+
+void ResourceGovernor::applyLimits()
+{
+  const double share = m_cpuSharePercent * 0.01 * m_adaptiveScale;
+
+  for (auto it = m_pools.begin(); it != m_pools.end();)
+  {
+    auto pool = it->toStrongRef();
+    if (!pool)
+    {
+      it = m_pools.erase(it);
+      continue;
+    }
+
+    const size_t threads = pool->getNumberOfThreads();
+    pool->setActiveThreadLimit(std::max<size_t>(static_cast<size_t>(std::ceil(threads * share)), 1));
+    ++it;
+  }
+}
+
+// reads the cpu summary line of /proc/stat:
+// cpu  user nice system idle iowait irq softirq steal ...
+bool ResourceGovernor::sampleIoWait()
+{
+  QFile stat("/proc/stat");
+  if (!stat.open(QIODevice::ReadOnly))
+  {
+    return false;
+  }
+
+  const QStringList fields = QString::fromLatin1(stat.readLine()).simplified().split(' ');
+  if ((fields.size() < 6) || (fields[0] != "cpu"))
+  {
+    return false;
+  }
+
+  quint64 total = 0;
+  for (int i = 1; i < std::min(fields.size(), 9); i++)  // guest times are already part of user time
+  {
+    total += fields[i].toULongLong();
+  }
+  const quint64 ioWait = fields[5].toULongLong();
+
+  const bool valid = (m_lastCpuTotal > 0) && (total > m_lastCpuTotal) && (ioWait >= m_lastCpuIoWait);
+  if (valid)
+  {
+    m_ioWait = static_cast<double>(ioWait - m_lastCpuIoWait) / (total - m_lastCpuTotal);
+  }
+
+  m_lastCpuTotal = total;
+  m_lastCpuIoWait = ioWait;
+  return valid;
+}
@@ -0,0 +1,108 @@
+#ifndef RESOURCEGOVERNOR_H
+#define RESOURCEGOVERNOR_H
+
+#include "regionfilereader.h"
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+#include <QWeakPointer>
+
+#include <chrono>
+#include <mutex>
+
+class PriorityThreadPool;
+
+// Limits the rate of a stream of reads, a request larger than the bucket is allowed but delays the following ones.
+class TokenBucket
+{
+public:
+  TokenBucket();
+
+  // bytesPerSecond == 0 -> unlimited
+  void setRate(qint64 bytesPerSecond);
+
+  // blocks the calling thread until the bytes fit into the rate limit
+  void acquire(qint64 bytes);
+
+private:
+  typedef std::chrono::steady_clock ClockT;
+
+  std::mutex m_mutex;
+  qint64 m_rate;
+  double m_tokens;
+  ClockT::time_point m_lastRefill;
+};
+
+// Limits the resources minutor takes away from other processes on the host (e.g. a running Minecraft server).
+//
+// Settings ("resources/..."):
+//   workers            worker threads of the foreground pool, 0 -> one per core (restart required)
+//   cpushare           percentage of the worker threads that are allowed to run at the same time
+//   backgroundpriority thread priority for background jobs like search and export (restart required)
+//   backgroundiolimit  MB/s read by background scans, 0 -> unlimited
+//   adaptive           reduce the running threads while the system is waiting for I/O (Linux only)
+//   scandirectio       background scans read with O_DIRECT instead of dropping the pages after reading (Linux only)
+class ResourceGovernor : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum class BackgroundPriority
+  {
+    normal,
+    nice,
+    idle  // SCHED_IDLE on Linux, only runs when a cpu would be idle otherwise
+  };
+
+  static ResourceGovernor& Instance();
+
+  size_t getWorkerCount() const;
+  size_t getBackgroundWorkerCount() const;
+
+  // cpu share and adaptive scaling are applied to the managed pools
+  void manage(const QSharedPointer<PriorityThreadPool>& pool);
+
+  // to be called by threads that only execute background jobs, can not be undone
+  void applyBackgroundPriorityToCurrentThread() const;
+
+  // called by background scans after reading from region files, foreground loads are not limited
+  void throttleBackgroundIo(qint64 bytes);
+
+  // background scans should not evict the data of other processes from the page cache
+  RegionReadMode getScanReadMode() const;
+
+  // fraction of the last interval the cpus waited for I/O, -1 when not available
+  double getIoWait() const;
+
+public slots:
+  void reloadSettings();
+
+private slots:
+  void adapt();
+
+private:
+  ResourceGovernor();
+
+  size_t m_workers;
+  int m_cpuSharePercent;
+  BackgroundPriority m_backgroundPriority;
+  bool m_adaptive;
+  bool m_scanDirectIo;
+
+  QVector<QWeakPointer<PriorityThreadPool> > m_pools;
+  double m_adaptiveScale;  // 0..1, applied on top of the cpu share
+  QTimer m_adaptTimer;
+
+  TokenBucket m_backgroundIo;
+
+  quint64 m_lastCpuTotal;
+  quint64 m_lastCpuIoWait;
+  double m_ioWait;
+
+  void applyLimits();
+  bool sampleIoWait();
+};
+
+#endif  // RESOURCEGOVERNOR_H
@@ -17,7 +17,7 @@ SearchChunksWidget::SearchChunksWidget(const SearchEntityWidgetInputC& input)
     , m_invoker()
     , m_threadPool(m_input.threadpool)
     , m_searchRunning(false)
-    , cancellation()
+    , m_searchJobs()
 {
   ui->setupUi(this);
 
@@ -34,7 +34,11 @@ SearchChunksWidget::SearchChunksWidget(const SearchEntityWidgetInputC& input)
 
 SearchChunksWidget::~SearchChunksWidget()
 {
-  cancelSearch();
+  auto runningJobsDone = cancelSearch();
+  if (runningJobsDone.valid())
+  {
+    runningJobsDone.wait();  // running jobs access this widget
+  }
 
   ui->plugin_context->layout()->removeWidget(&m_input.searchPlugin->getWidget());
 
@@ -43,7 +47,7 @@ SearchChunksWidget::~SearchChunksWidget()
 
 void SearchChunksWidget::on_pb_search_clicked()
 {
-  if (cancellation)
+  if (m_searchJobs)
   {
     cancelSearch();
     return;
@@ -51,8 +55,8 @@ void SearchChunksWidget::on_pb_search_clicked()
 
   ui->pb_search->setText("Cancel");
 
-  cancellation = CancellationPtr::create();
-  auto weakCancel = cancellation.getWeakToken();
+  m_searchJobs = JobGroup::create();
+  const auto searchJobs = m_searchJobs;
 
   m_chunksRequestedToSearchList.clear();
 
@@ -84,7 +88,7 @@ void SearchChunksWidget::on_pb_search_clicked()
     if ((count++ % 100) == 0)
       QApplication::processEvents();
 
-    if (weakCancel.isCanceled())
+    if (searchJobs->isCanceled())
     {
       return;
     }
@@ -104,22 +108,19 @@ void SearchChunksWidget::requestSearchingOfChunk(ChunkID id)
     return;
   }
 
-  m_threadPool->enqueueJob([this, id, cancelToken = cancellation.getToken()]()
+  m_threadPool->enqueueJob([this, id]()
   {
-    if (!cancelToken.isCanceled())
-    {
-      auto chunk = m_input.cache->getChunkSynchronously(id);
+    auto chunk = m_input.cache->getChunkSynchronously(id, ChunkReadMode::background);
 
-      m_invoker.invoke([this, chunk, id](){
-        chunkLoaded(chunk, id.getX(), id.getZ());
-      });
-    }
-  });
+    m_invoker.invoke([this, chunk, id](){
+      chunkLoaded(chunk, id.getX(), id.getZ());
+    });
+  }, PriorityThreadPool::JobPrio::low, m_searchJobs, JobClass::search);
 }
 
 void SearchChunksWidget::chunkLoaded(const QSharedPointer<Chunk>& chunk, int x, int z)
 {
-  if (!cancellation || cancellation->isCanceled())
+  if (!m_searchJobs || m_searchJobs->isCanceled())
   {
     return;
   }
@@ -160,13 +161,8 @@ void SearchChunksWidget::searchLoadedChunk(const QSharedPointer<Chunk>& chunk)
 {
   const Range<float> range_y = helperRangeCreation(*ui->check_range_y, *ui->sb_y_start, *ui->sb_y_end);
 
-  auto job = [this, chunk, range_y, cancelToken = cancellation.getToken(), searchPlug = m_input.searchPlugin]()
+  auto job = [this, chunk, range_y, searchJobs = m_searchJobs, searchPlug = m_input.searchPlugin]()
   {
-    if (cancelToken.isCanceled())
-    {
-      return;
-    }
-
     ChunkID id(chunk->getChunkX(), chunk->getChunkZ());
 
     auto results_tmp = searchPlug->searchChunk(*chunk);
@@ -180,8 +176,8 @@ void SearchChunksWidget::searchLoadedChunk(const QSharedPointer<Chunk>& chunk)
       }
     }
 
-    m_invoker.invoke([this, cancelToken = cancelToken.toWeakToken(), results, id](){
-      if (cancelToken.isCanceled())
+    m_invoker.invoke([this, searchJobs, results, id](){
+      if (searchJobs->isCanceled())
       {
         return;
       }
@@ -190,7 +186,7 @@ void SearchChunksWidget::searchLoadedChunk(const QSharedPointer<Chunk>& chunk)
     });
   };
 
-  m_threadPool->enqueueJob(job, PriorityThreadPool::JobPrio::high);
+  m_threadPool->enqueueJob(job, PriorityThreadPool::JobPrio::high, m_searchJobs, JobClass::search);
 }
 
 
@@ -215,13 +211,21 @@ void SearchChunksWidget::addOneToProgress(ChunkID /* id */)
   }
 }
 
-void SearchChunksWidget::cancelSearch()
+std::shared_future<void> SearchChunksWidget::cancelSearch()
 {
-  cancellation.cancelAndWait();
+  // does not wait for running jobs, their results are ignored
+  std::shared_future<void> runningJobsDone;
+  if (m_searchJobs)
+  {
+    runningJobsDone = m_threadPool->cancelGroup(m_searchJobs);
+    m_searchJobs.reset();
+  }
 
   ui->pb_search->setText("Search");
 
   ui->resultList->searchDone();
+
+  return runningJobsDone;
 }
 
 void SearchChunksWidget::on_resultList_jumpTo(const QVector3D &pos)
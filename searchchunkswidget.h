@@ -8,7 +8,7 @@
 #include "coordinatehashmap.h"
 #include "prioritythreadpool.h"
 #include "value_initialized.h"
-#include "cancellation.hpp"
+#include "jobgroup.hpp"
 #include "safeinvoker.h"
 
 #include <QWidget>
@@ -80,7 +80,7 @@ private:
     QSharedPointer<PriorityThreadPool> m_threadPool;
     CoordinateHashMap<value_initialized<bool> > m_chunksRequestedToSearchList;
     bool m_searchRunning;
-    CancellationPtr cancellation;
+    JobGroupPtr m_searchJobs;  // jobs of the running search
 
     void requestSearchingOfChunk(ChunkID id);
 
@@ -88,7 +88,7 @@ private:
 
     void addOneToProgress(ChunkID id);
 
-    void cancelSearch();
+    std::shared_future<void> cancelSearch();
 };
 
 #endif // SEARCHENTITYWIDGET_H
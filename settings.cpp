@@ -52,6 +52,14 @@ Settings::Settings(QWidget *parent) : QDialog(parent) {
   m_ui.checkBox_VerticalDepth->setChecked(verticalDepth);
   m_ui.checkBox_fine_zoom->setChecked(fineZoom);
   m_ui.checkBox_zoom_out->setChecked(zoomOut);
+
+  // resource limits are read by the ResourceGovernor
+  m_ui.spinBox_workers->setValue(info.value("resources/workers", 0).toInt());
+  m_ui.spinBox_cpu_share->setValue(info.value("resources/cpushare", 100).toInt());
+  m_ui.comboBox_background_priority->setCurrentIndex(info.value("resources/backgroundpriority", 0).toInt());
+  m_ui.spinBox_background_io_limit->setValue(info.value("resources/backgroundiolimit", 0).toInt());
+  m_ui.checkBox_adaptive_threads->setChecked(info.value("resources/adaptive", false).toBool());
+  m_ui.checkBox_scan_direct_io->setChecked(info.value("resources/scandirectio", false).toBool());
 }
 
 QString Settings::getDefaultLocation()
@@ -145,3 +153,45 @@ void Settings::on_checkBox_chunk_cache_status_toggled(bool checked)
   info.setValue("chunkcachestatus", checked);
   emit settingsUpdated();
 }
+
+void Settings::on_spinBox_workers_valueChanged(int value)
+{
+  QSettings info;
+  info.setValue("resources/workers", value);
+  emit settingsUpdated();
+}
+
+void Settings::on_spinBox_cpu_share_valueChanged(int value)
+{
+  QSettings info;
+  info.setValue("resources/cpushare", value);
+  emit settingsUpdated();
+}
+
+void Settings::on_comboBox_background_priority_currentIndexChanged(int index)
+{
+  QSettings info;
+  info.setValue("resources/backgroundpriority", index);
+  emit settingsUpdated();
+}
+
+void Settings::on_spinBox_background_io_limit_valueChanged(int value)
+{
+  QSettings info;
+  info.setValue("resources/backgroundiolimit", value);
+  emit settingsUpdated();
+}
+
+void Settings::on_checkBox_adaptive_threads_toggled(bool checked)
+{
+  QSettings info;
+  info.setValue("resources/adaptive", checked);
+  emit settingsUpdated();
+}
+
+void Settings::on_checkBox_scan_direct_io_toggled(bool checked)
+{
+  QSettings info;
+  info.setValue("resources/scandirectio", checked);
+  emit settingsUpdated();
+}
@@ -42,6 +42,18 @@ class Settings : public QDialog {
 
   void on_checkBox_chunk_cache_status_toggled(bool checked);
 
+  void on_spinBox_workers_valueChanged(int value);
+
+  void on_spinBox_cpu_share_valueChanged(int value);
+
+  void on_comboBox_background_priority_currentIndexChanged(int index);
+
+  void on_spinBox_background_io_limit_valueChanged(int value);
+
+  void on_checkBox_adaptive_threads_toggled(bool checked);
+
+  void on_checkBox_scan_direct_io_toggled(bool checked);
+
 private:
   Ui::Settings m_ui;
 };
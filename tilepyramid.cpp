@@ -0,0 +1,241 @@
+#include "./tilepyramid.h"
+#include "./rendersettings.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  // not fed yet: average color of the placeholder of missing chunks, see getPlaceholder()
+  const QRgb s_emptyColor = qRgb(0x66, 0x66, 0x66);
+
+  // rounded average of 4 pixels, two channels per 32 bit word (4 * 255 fits into each 16 bit lane)
+  inline quint32 average4(quint32 a, quint32 b, quint32 c, quint32 d)
+  {
+    const quint32 rb = (a & 0x00ff00ff) + (b & 0x00ff00ff) + (c & 0x00ff00ff) + (d & 0x00ff00ff);
+    const quint32 ag = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff) + ((c >> 8) & 0x00ff00ff) + ((d >> 8) & 0x00ff00ff);
+    return (((rb + 0x00020002) >> 2) & 0x00ff00ff) | (((ag + 0x00020002) << 6) & 0xff00ff00);
+  }
+
+  // the images don't depend on the level of detail (for the pyramid) and showing entities
+  bool sameImages(const RenderParams& a, const RenderParams& b)
+  {
+    return (a.renderedAt == b.renderedAt) &&
+           (((a.renderedFlags ^ b.renderedFlags) & ~RenderSettings::ShowEntities) == 0);
+  }
+}
+
+QRgb TilePyramid::getEmptyColor()
+{
+  return s_emptyColor;
+}
+
+int TilePyramid::levelForZoom(double zoom)
+{
+  int level = 0;
+  while ((level < MaxLevel) && (zoom * (2 << level) <= 1.0))
+  {
+    level++;
+  }
+  return level;
+}
+
+CoordinateID TilePyramid::getTileID(int level, const ChunkGroupID& cgid)
+{
+  return CoordinateID(cgid.getX() >> level, cgid.getZ() >> level);
+}
+
+QRect TilePyramid::getTileRect(int level, const CoordinateID& tile)
+{
+  const int size = ChunkGroupID::getSize().width() << level;
+  return QRect(tile.getX() * size, tile.getZ() * size, size, size);
+}
+
+QHash<CoordinateID, quint32> TilePyramid::getTileTimestamps(int level, const QHash<ChunkGroupID, quint32>& groupTimestamps)
+{
+  QHash<CoordinateID, quint32> timestamps;
+  for (auto it = groupTimestamps.begin(); it != groupTimestamps.end(); ++it)
+  {
+    quint32& newest = timestamps[getTileID(level, it.key())];
+    newest = std::max(newest, it.value());
+  }
+  return timestamps;
+}
+
+void TilePyramid::update(const ChunkGroupID& cgid, const QImage& groupImage, bool complete, const RenderParams& params)
+{
+  const int groupPixels = TileSize >> MinLevel;  // pixels of one chunk group in MinLevel
+
+  // the expensive part without lock
+  QImage image = groupImage.convertToFormat(QImage::Format_RGB32);
+  while (image.width() >= 2 * groupPixels)
+  {
+    QImage half(image.size() / 2, QImage::Format_RGB32);
+    downsample(image, image.rect(), half, QPoint(0, 0));
+    image = half;
+  }
+  if (image.size() != QSize(groupPixels, groupPixels))
+  {
+    image = image.scaled(groupPixels, groupPixels);
+  }
+
+  QMutexLocker locker(&m_mutex);
+
+  if (!sameImages(params, m_params))
+  {
+    return;  // rendered before the settings changed
+  }
+
+  if (complete)
+  {
+    m_complete.insert(cgid, params);
+    m_incomplete.remove(cgid);
+  }
+  else
+  {
+    m_complete.remove(cgid);
+    m_incomplete.insert(cgid);
+  }
+
+  const int mask = (1 << MinLevel) - 1;
+  CoordinateID tile = getTileID(MinLevel, cgid);
+  QRect dirty((cgid.getX() & mask) * groupPixels, (cgid.getZ() & mask) * groupPixels, groupPixels, groupPixels);
+
+  m_changed[0].insert(tile);
+  QImage& base = getOrCreateTile_unprotected(MinLevel, tile);
+  for (int z = 0; z < groupPixels; z++)
+  {
+    memcpy(base.scanLine(dirty.top() + z) + dirty.left() * 4, image.constScanLine(z), groupPixels * 4);
+  }
+
+  // each level only averages the pixels that changed in the level below
+  for (int level = MinLevel + 1; level <= MaxLevel; level++)
+  {
+    const QImage child = m_tiles[level - 1 - MinLevel].value(tile);
+    const CoordinateID parentTile(tile.getX() >> 1, tile.getZ() >> 1);
+
+    const QRect aligned(QPoint(dirty.left() & ~1, dirty.top() & ~1), QPoint(dirty.right() | 1, dirty.bottom() | 1));
+    const QPoint target(((tile.getX() & 1) * TileSize + aligned.left()) / 2,
+                        ((tile.getZ() & 1) * TileSize + aligned.top()) / 2);
+
+    downsample(child, aligned, getOrCreateTile_unprotected(level, parentTile), target);
+    m_changed[level - MinLevel].insert(parentTile);
+
+    dirty = QRect(target, aligned.size() / 2);
+    tile = parentTile;
+  }
+}
+
+QImage TilePyramid::getTile(int level, const CoordinateID& tile) const
+{
+  if ((level < MinLevel) || (level > MaxLevel))
+  {
+    return QImage();
+  }
+
+  QMutexLocker locker(&m_mutex);
+  return m_tiles[level - MinLevel].value(tile);
+}
+
+bool TilePyramid::isComplete(const ChunkGroupID& cgid, const RenderParams& params) const
+{
+  QMutexLocker locker(&m_mutex);
+  const auto it = m_complete.find(cgid);
+
+  // any level of detail is fine enough for the tiles
+  return (it != m_complete.end()) && it->isValidFor(RenderParams(params.renderedAt, params.renderedFlags, it->lod));
+}
+
+QVector<TilePyramid::Tile> TilePyramid::takeChangedTiles()
+{
+  QMutexLocker locker(&m_mutex);
+
+  QVector<Tile> changed;
+  for (int level = MinLevel; level <= MaxLevel; level++)
+  {
+    QSet<CoordinateID> mixed;
+    for (const auto& cgid: m_incomplete)
+    {
+      mixed.insert(getTileID(level, cgid));
+    }
+
+    QSet<CoordinateID>& levelChanged = m_changed[level - MinLevel];
+    for (auto it = levelChanged.begin(); it != levelChanged.end(); )
+    {
+      if (mixed.contains(*it))
+      {
+        ++it;
+        continue;
+      }
+      changed.append(Tile{level, *it, m_tiles[level - MinLevel].value(*it)});
+      it = levelChanged.erase(it);
+    }
+  }
+  return changed;
+}
+
+void TilePyramid::insertTile(int level, const CoordinateID& tile, const QImage& image)
+{
+  if ((level < MinLevel) || (level > MaxLevel) || (image.size() != QSize(TileSize, TileSize)))
+  {
+    return;
+  }
+
+  QMutexLocker locker(&m_mutex);
+  QImage& existing = m_tiles[level - MinLevel][tile];
+  if (existing.isNull())
+  {
+    existing = image.convertToFormat(QImage::Format_RGB32);
+  }
+}
+
+void TilePyramid::clear(const RenderParams& params)
+{
+  QMutexLocker locker(&m_mutex);
+  m_params = params;
+  for (auto& tiles: m_tiles)
+  {
+    tiles.clear();
+  }
+  for (auto& changed: m_changed)
+  {
+    changed.clear();
+  }
+  m_complete.clear();
+  m_incomplete.clear();
+}
+
+RenderParams TilePyramid::getParams() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_params;
+}
+
+void TilePyramid::downsample(const QImage& src, const QRect& srcRect, QImage& dst, const QPoint& dstPos)
+{
+  const int width = srcRect.width() / 2;
+  const int height = srcRect.height() / 2;
+
+  for (int z = 0; z < height; z++)
+  {
+    const quint32 *row0 = reinterpret_cast<const quint32*>(src.constScanLine(srcRect.top() + 2 * z)) + srcRect.left();
+    const quint32 *row1 = reinterpret_cast<const quint32*>(src.constScanLine(srcRect.top() + 2 * z + 1)) + srcRect.left();
+    quint32 *out = reinterpret_cast<quint32*>(dst.scanLine(dstPos.y() + z)) + dstPos.x();
+
+    for (int x = 0; x < width; x++)
+    {
+      out[x] = average4(row0[2 * x], row0[2 * x + 1], row1[2 * x], row1[2 * x + 1]);
+    }
+  }
+}
+
+QImage& TilePyramid::getOrCreateTile_unprotected(int level, const CoordinateID& tile)
+{
+  QImage& image = m_tiles[level - MinLevel][tile];
+  if (image.isNull())
+  {
+    image = QImage(TileSize, TileSize, QImage::Format_RGB32);
+    image.fill(s_emptyColor);
+  }
+  return image;
+}
@@ -0,0 +1,89 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include "./chunk.h"
+#include "./coordinateid.h"
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
+
+// Downsampled copies of the chunk group images for zoom levels below the coarsest level of detail.
+//
+// A tile of level L has TileSize x TileSize pixels and covers 2^L x 2^L chunk groups, one pixel for 2^L x 2^L
+// blocks. Levels below MinLevel are the chunk group images themselves (rendered with RenderSettings::lod = 2^L).
+// MinLevel is fed from the chunk group images, every coarser level from the one below with a 2x2 box filter.
+// Feeding a group only updates the pixels above it. The tiles belong to the depth and flags given to clear(),
+// images of other settings are not fed. Thread safe.
+class TilePyramid
+{
+public:
+  enum
+  {
+    MinLevel = 4,  // 16 blocks per pixel
+    MaxLevel = 9,  // 512 blocks per pixel, one pixel per region
+    TileSize = 256
+  };
+
+  // level whose pixels match the zoom (pixels per block), 0 .. MaxLevel, see RenderSettings::lodForZoom()
+  static int levelForZoom(double zoom);
+
+  // color of the pixels nothing was fed for yet
+  static QRgb getEmptyColor();
+
+  // tile of the level containing the chunk group
+  static CoordinateID getTileID(int level, const ChunkGroupID& cgid);
+
+  // area of a tile in blocks
+  static QRect getTileRect(int level, const CoordinateID& tile);
+
+  // newest of the timestamps of the chunk groups beneath each tile of the level
+  static QHash<CoordinateID, quint32> getTileTimestamps(int level, const QHash<ChunkGroupID, quint32>& groupTimestamps);
+
+  // copies the image of a chunk group (any level of detail) into all levels, complete when all of its
+  // chunks were rendered with params. Ignored when params has other depth or flags than the pyramid
+  void update(const ChunkGroupID& cgid, const QImage& groupImage, bool complete, const RenderParams& params);
+
+  // null when nothing beneath the tile was fed yet
+  QImage getTile(int level, const CoordinateID& tile) const;
+
+  // true when the group was completely fed with an image that is valid for depth and flags of params
+  bool isComplete(const ChunkGroupID& cgid, const RenderParams& params) const;
+
+  struct Tile
+  {
+    int level;
+    CoordinateID id;
+    QImage image;
+  };
+
+  // tiles changed by update() since the last call, except the ones above a group fed incompletely:
+  // its image still has pixels of other settings, the tile is returned once the group was fed completely
+  QVector<Tile> takeChangedTiles();
+
+  // tile of an earlier session (see TileStore), ignored when the tile was fed already
+  void insertTile(int level, const CoordinateID& tile, const QImage& image);
+
+  // removes all tiles, the pyramid is fed with images of depth and flags of params afterwards
+  void clear(const RenderParams& params);
+
+  // depth and flags the tiles belong to
+  RenderParams getParams() const;
+
+private:
+  // averages 2x2 pixel blocks of srcRect into dst at dstPos
+  static void downsample(const QImage& src, const QRect& srcRect, QImage& dst, const QPoint& dstPos);
+
+  QImage& getOrCreateTile_unprotected(int level, const CoordinateID& tile);
+
+  mutable QMutex m_mutex;
+  QHash<CoordinateID, QImage> m_tiles[MaxLevel - MinLevel + 1];
+  QSet<CoordinateID> m_changed[MaxLevel - MinLevel + 1];
+  QHash<ChunkGroupID, RenderParams> m_complete;
+  QSet<ChunkGroupID> m_incomplete;  // fed, but not completely
+  RenderParams m_params;
+};
+
+#endif  // TILEPYRAMID_H
@@ -0,0 +1,187 @@
+#include "./tilestore.h"
+#include "./rendersettings.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+  const quint32 s_magic = 0x4d54494c;  // "MTIL"
+  const quint16 s_version = 2;  // 2: pyramid tiles with timestamp
+
+  enum TileKind : quint8
+  {
+    GroupTileKind,
+    PyramidTileKind
+  };
+
+  bool openTile(QFile& file, QDataStream& stream, TileKind kind)
+  {
+    if (!file.open(QIODevice::ReadOnly))
+    {
+      return false;
+    }
+
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint8 storedKind = 0;
+    stream >> magic >> version >> storedKind;
+    return (magic == s_magic) && (version == s_version) && (storedKind == kind);
+  }
+
+  void writeHeader(QDataStream& stream, TileKind kind)
+  {
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << s_magic << s_version << static_cast<quint8>(kind);
+  }
+
+  // one directory per world, named by a hash of its path
+  QString getWorldDirectory(const QString& path)
+  {
+    const QByteArray hash = QCryptographicHash::hash(QDir(path).absolutePath().toUtf8(), QCryptographicHash::Md5);
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/tiles/" + hash.toHex().left(16);
+  }
+}
+
+TileStore::TileStore(const QString& path)
+  : m_worldDirectory(getWorldDirectory(path))
+{}
+
+bool TileStore::loadGroup(const RenderParams& params, const ChunkGroupID& cgid, GroupTile& tile) const
+{
+  // a finer level of detail will do as well, it is scaled down
+  for (int lod = params.lod; lod >= 1; lod /= 2)
+  {
+    QFile file(getDirectory(params) + QString("/g%1.%2.%3.tile").arg(lod).arg(cgid.getX()).arg(cgid.getZ()));
+    QDataStream stream;
+    if (!openTile(file, stream, GroupTileKind))
+    {
+      continue;
+    }
+
+    stream >> tile.timestamp >> tile.renderedImg >> tile.depthImg;
+    tile.lod = lod;
+    if ((stream.status() == QDataStream::Ok) && !tile.renderedImg.isNull() && !tile.depthImg.isNull())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TileStore::saveGroup(const RenderParams& params, const ChunkGroupID& cgid, const GroupTile& tile)
+{
+  const QString directory = createDirectory(params);
+  if (directory.isEmpty())
+  {
+    return;
+  }
+
+  QSaveFile file(directory + QString("/g%1.%2.%3.tile").arg(tile.lod).arg(cgid.getX()).arg(cgid.getZ()));
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    return;
+  }
+
+  QDataStream stream(&file);
+  writeHeader(stream, GroupTileKind);
+  stream << tile.timestamp << tile.renderedImg << tile.depthImg;
+  file.commit();
+}
+
+QHash<CoordinateID, TileStore::PyramidTile> TileStore::loadPyramidLevel(const RenderParams& params, int level) const
+{
+  QHash<CoordinateID, PyramidTile> tiles;
+
+  QDirIterator it(getDirectory(params), QStringList() << QString("p%1.*.tile").arg(level), QDir::Files);
+  while (it.hasNext())
+  {
+    it.next();
+    const QStringList parts = it.fileName().split('.');
+    bool validX = false;
+    bool validZ = false;
+    const int tx = parts.value(1).toInt(&validX);
+    const int tz = parts.value(2).toInt(&validZ);
+    if ((parts.size() != 4) || !validX || !validZ)
+    {
+      continue;
+    }
+
+    QFile file(it.filePath());
+    QDataStream stream;
+    PyramidTile tile;
+    if (openTile(file, stream, PyramidTileKind))
+    {
+      stream >> tile.timestamp >> tile.image;
+      if ((stream.status() == QDataStream::Ok) && !tile.image.isNull())
+      {
+        tiles.insert(CoordinateID(tx, tz), tile);
+      }
+    }
+  }
+
+  return tiles;
+}
+
+void TileStore::savePyramidTile(const RenderParams& params, int level, const CoordinateID& id, const PyramidTile& tile)
+{
+  const QString directory = createDirectory(params);
+  if (directory.isEmpty())
+  {
+    return;
+  }
+
+  QSaveFile file(directory + QString("/p%1.%2.%3.tile").arg(level).arg(id.getX()).arg(id.getZ()));
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    return;
+  }
+
+  QDataStream stream(&file);
+  writeHeader(stream, PyramidTileKind);
+  stream << tile.timestamp << tile.image;
+  file.commit();
+}
+
+QString TileStore::getDirectory(const RenderParams& params) const
+{
+  // the images don't depend on showing entities
+  const int flags = params.renderedFlags & ~RenderSettings::ShowEntities;
+  return m_worldDirectory + QString("/d%1_f%2").arg(params.renderedAt).arg(flags, 0, 16);
+}
+
+QString TileStore::createDirectory(const RenderParams& params)
+{
+  QMutexLocker locker(&m_mutex);
+
+  const QString directory = getDirectory(params);
+  if (QDir(directory).exists())
+  {
+    return directory;
+  }
+
+  if (!QDir().mkpath(directory))
+  {
+    return QString();
+  }
+
+  // keep the most recently written sets, e.g. dragging the depth slider creates one for every depth
+  const QFileInfoList sets = QDir(m_worldDirectory).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Time);
+  for (int i = MaxParamSets; i < sets.size(); i++)
+  {
+    if (sets[i].absoluteFilePath() != QDir(directory).absolutePath())
+    {
+      QDir(sets[i].absoluteFilePath()).removeRecursively();
+    }
+  }
+
+  return directory;
+}
@@ -0,0 +1,61 @@
+#ifndef TILESTORE_H
+#define TILESTORE_H
+
+#include "./chunk.h"
+#include "./coordinateid.h"
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+// Rendered chunk group images and tile pyramid tiles of one world on disk, so reopening it shows the map at once.
+//
+// The tiles of every depth and combination of flags are kept in their own directory below the cache location of
+// the application, only the most recently used ones are kept. Chunk group and pyramid tiles record the newest
+// timestamp of the chunks they cover (see RegionFileReader::readTimestamps()), they are stale when one of them
+// was saved since.
+// Tiles are written with QSaveFile, so loading never sees half written files. Thread safe, jobs keep the store of
+// the world they were started for.
+class TileStore
+{
+public:
+  enum
+  {
+    MaxParamSets = 8  // directories of depth and flags kept per world
+  };
+
+  struct GroupTile
+  {
+    QImage renderedImg;
+    QImage depthImg;
+    int lod;            // each level of detail is stored separately
+    quint32 timestamp;  // newest chunk when it was rendered
+  };
+
+  struct PyramidTile
+  {
+    QImage image;
+    quint32 timestamp;  // newest chunk beneath it when it was saved
+  };
+
+  // path of the dimension
+  explicit TileStore(const QString& path);
+
+  // tile with the level of detail of params, or a finer one
+  bool loadGroup(const RenderParams& params, const ChunkGroupID& cgid, GroupTile& tile) const;
+  void saveGroup(const RenderParams& params, const ChunkGroupID& cgid, const GroupTile& tile);
+
+  // all stored tiles of one level of the pyramid
+  QHash<CoordinateID, PyramidTile> loadPyramidLevel(const RenderParams& params, int level) const;
+  void savePyramidTile(const RenderParams& params, int level, const CoordinateID& id, const PyramidTile& tile);
+
+private:
+  QString getDirectory(const RenderParams& params) const;
+  QString createDirectory(const RenderParams& params);
+
+  const QString m_worldDirectory;
+  QMutex m_mutex;  // creating and pruning directories
+};
+
+#endif  // TILESTORE_H
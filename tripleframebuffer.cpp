@@ -0,0 +1,40 @@
+#include "./tripleframebuffer.h"
+
+#include <utility>
+
+TripleFrameBuffer::Frame& TripleFrameBuffer::back(const QSize& size, QImage::Format format)
+{
+  QMutexLocker locker(&m_mutex);
+
+  Frame& frame = m_frames[m_back];
+  if ((frame.image.size() != size) || (frame.image.format() != format))
+  {
+    frame.image = QImage(size, format);
+    frame.damage = QRegion(frame.image.rect());
+  }
+  return frame;
+}
+
+void TripleFrameBuffer::publish(const QRegion& changed)
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_frames[m_latest].damage += changed;
+  m_frames[m_front].damage += changed;
+  m_frames[m_back].damage = QRegion();
+
+  std::swap(m_back, m_latest);
+  m_latestIsNew = true;
+}
+
+const TripleFrameBuffer::Frame& TripleFrameBuffer::front()
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (m_latestIsNew)
+  {
+    std::swap(m_front, m_latest);
+    m_latestIsNew = false;
+  }
+  return m_frames[m_front];
+}
@@ -0,0 +1,45 @@
+#ifndef TRIPLEFRAMEBUFFER_H
+#define TRIPLEFRAMEBUFFER_H
+
+#include <QImage>
+#include <QMutex>
+#include <QRegion>
+
+// Frames written by one thread and shown by another, neither waits for the other.
+//
+// The writer fills the back buffer while the front buffer is shown, the latest finished frame waits in between
+// until it is shown or replaced by a newer one. Each buffer collects the damage of the frames it missed, so the
+// writer only brings that part of the back buffer up to date.
+class TripleFrameBuffer
+{
+public:
+  struct Frame
+  {
+    QImage image;
+    QRegion damage;  // out of date compared to the latest frame
+
+    // view the frame shows: center in blocks and pixels per block
+    double x = 0.0;
+    double z = 0.0;
+    double zoom = 1.0;
+  };
+
+  // writer: the buffer to write, all damaged when it is (re)created for another size
+  Frame& back(const QSize& size, QImage::Format format);
+
+  // writer: the back buffer becomes the latest frame, changed is what differs from the previous one
+  void publish(const QRegion& changed);
+
+  // reader: the latest frame, unchanged until the next call
+  const Frame& front();
+
+private:
+  QMutex m_mutex;
+  Frame m_frames[3];
+  int m_back = 0;
+  int m_latest = 1;
+  int m_front = 2;
+  bool m_latestIsNew = false;
+};
+
+#endif  // TRIPLEFRAMEBUFFER_H
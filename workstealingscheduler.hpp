@@ -0,0 +1,324 @@
+#ifndef WORKSTEALINGSCHEDULER_HPP
+#define WORKSTEALINGSCHEDULER_HPP
+
+#include "dynamicpriorityqueue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Scheduler for a fixed set of worker threads.
+//
+// Every worker owns a deque per priority class. Items pushed by a worker thread go to its own deque
+// (no contention), items pushed from outside (e.g. GUI thread) go to a small global injection queue
+// per priority class. A worker takes work in this order, checking all sources of a higher priority
+// class before looking at the next lower one:
+//   own deque (newest first) -> injection queue -> steal from other workers (oldest first)
+// Within a priority class an injected item with a smaller key than the newest own item is taken first,
+// so follow-up jobs a worker pushes for itself don't hold back urgent jobs from outside.
+// Idle workers park on a condition variable instead of spinning.
+// Workers with an index above the active worker limit park as well, their queued items are stolen by the others.
+//
+// Within the injection queues items are ordered by KeyFunctionT (smaller first, see DynamicPriorityQueue).
+// The keys are evaluated again by the next worker looking at a queue after reevaluatePriorities() was called,
+// keys are never evaluated while a queue is locked.
+template <typename T, typename KeyFunctionT = ConstantPriorityKey>
+class WorkStealingScheduler
+{
+public:
+  enum {
+    PrioClasses = 2
+  };
+
+  explicit WorkStealingScheduler(size_t numberOfWorkers, const KeyFunctionT& keyFunction = KeyFunctionT())
+    : m_keyFunction(keyFunction)
+    , m_alive(true)
+    , m_priorityGeneration(0)
+    , m_pending(0)
+    , m_sleeping(0)
+    , m_activeWorkers(numberOfWorkers)
+  {
+    for (size_t i = 0; i < numberOfWorkers; i++)
+    {
+      m_workers.push_back(std::make_unique<WorkerQueue>());
+    }
+  }
+
+  size_t getNumberOfWorkers() const
+  {
+    return m_workers.size();
+  }
+
+  // limit is clamped to [1, number of workers]
+  void setActiveWorkerLimit(size_t limit)
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_parkMutex);
+      m_activeWorkers = std::max<size_t>(std::min(limit, m_workers.size()), 1);
+    }
+    m_parkCondition.notify_all();
+  }
+
+  size_t getActiveWorkerLimit() const
+  {
+    return m_activeWorkers;
+  }
+
+  // has to be called once by each worker thread before calling pop()
+  void registerCurrentThreadAsWorker(size_t workerIndex)
+  {
+    currentWorker().scheduler = this;
+    currentWorker().index = workerIndex;
+  }
+
+  size_t push(T&& item, size_t prioClass)
+  {
+    // counted before the item is visible, a worker taking it right away must not see the counter wrap
+    const size_t pending = ++m_pending;
+
+    const WorkerContext& ctx = currentWorker();
+    if (ctx.scheduler == this)
+    {
+      WorkerQueue& own = *m_workers[ctx.index];
+      std::lock_guard<std::mutex> guard(own.mutex);
+      own.items[prioClass].push_back(std::move(item));
+    }
+    else
+    {
+      InjectionQueue& injection = m_injection[prioClass];
+      const double key = injection.items.keyOf(item);
+      std::lock_guard<std::mutex> guard(injection.mutex);
+      injection.items.push(std::move(item), key);
+    }
+
+    if (m_sleeping > 0)
+    {
+      std::lock_guard<std::mutex> guard(m_parkMutex);
+      if (m_activeWorkers < m_workers.size())
+      {
+        m_parkCondition.notify_all();  // notify_one could wake up an inactive worker only
+      }
+      else
+      {
+        m_parkCondition.notify_one();
+      }
+    }
+
+    return pending;
+  }
+
+  size_t push(const T& item, size_t prioClass)
+  {
+    T copy(item);
+    return push(std::move(copy), prioClass);
+  }
+
+  // blocks until an item is available, returns false when terminated and no work is left
+  bool pop(size_t workerIndex, T& item)
+  {
+    while (true)
+    {
+      if (isActive(workerIndex) && tryPop(workerIndex, item))
+      {
+        return true;
+      }
+
+      std::unique_lock<std::mutex> lock(m_parkMutex);
+      if (!m_alive && (m_pending == 0))
+      {
+        return false;
+      }
+
+      m_sleeping++;
+      while (((m_pending == 0) || !isActive(workerIndex)) && m_alive)
+      {
+        m_parkCondition.wait(lock);
+      }
+      m_sleeping--;
+    }
+  }
+
+  void signalTerminate()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_parkMutex);
+      m_alive = false;
+    }
+    m_parkCondition.notify_all();
+  }
+
+  // keys of queued items changed -> re-sort the injection queues before the next pop
+  void reevaluatePriorities()
+  {
+    m_priorityGeneration++;
+  }
+
+  size_t getPriorityGeneration() const
+  {
+    return m_priorityGeneration;
+  }
+
+  size_t getCurrentQueueLength() const
+  {
+    return m_pending;
+  }
+
+private:
+  struct WorkerContext
+  {
+    const WorkStealingScheduler* scheduler;
+    size_t index;
+  };
+
+  static WorkerContext& currentWorker()
+  {
+    static thread_local WorkerContext context = { nullptr, 0 };
+    return context;
+  }
+
+  // allocated separately to keep the queues of different workers apart in memory
+  struct WorkerQueue
+  {
+    std::mutex mutex;
+    std::deque<T> items[PrioClasses];
+  };
+
+  struct InjectionQueue
+  {
+    std::mutex mutex;
+    DynamicPriorityQueue<T, KeyFunctionT> items;
+    std::atomic<size_t> keyedGeneration{0};  // priority generation of the last rekey
+  };
+
+  const KeyFunctionT m_keyFunction;
+  std::vector<std::unique_ptr<WorkerQueue> > m_workers;
+  InjectionQueue m_injection[PrioClasses];
+
+  std::atomic<bool> m_alive;
+  std::atomic<size_t> m_priorityGeneration;
+  std::atomic<size_t> m_pending;   // number of queued items in all queues
+  std::atomic<size_t> m_sleeping;  // number of parked workers
+  std::atomic<size_t> m_activeWorkers;
+  std::mutex m_parkMutex;
+  std::condition_variable m_parkCondition;
+
+  // all workers help to empty the queues when terminating
+  bool isActive(size_t workerIndex) const
+  {
+    return (workerIndex < m_activeWorkers) || !m_alive;
+  }
+
+  bool tryPop(size_t workerIndex, T& item)
+  {
+    for (size_t prio = 0; prio < PrioClasses; prio++)
+    {
+      rekeyInjected(prio);
+      if (popOwnOrInjected(workerIndex, prio, item) ||
+          popInjected(prio, item) ||
+          steal(workerIndex, prio, item))
+      {
+        m_pending--;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool popOwn(size_t workerIndex, size_t prio, T& item)
+  {
+    WorkerQueue& own = *m_workers[workerIndex];
+    std::lock_guard<std::mutex> guard(own.mutex);
+    auto& items = own.items[prio];
+    if (items.empty())
+    {
+      return false;
+    }
+
+    item = std::move(items.back());
+    items.pop_back();
+    return true;
+  }
+
+  // the newest own item, unless the best injected one has a smaller key
+  bool popOwnOrInjected(size_t workerIndex, size_t prio, T& item)
+  {
+    if (!popOwn(workerIndex, prio, item))
+    {
+      return false;
+    }
+
+    double injectedKey;
+    {
+      InjectionQueue& injection = m_injection[prio];
+      std::lock_guard<std::mutex> guard(injection.mutex);
+      if (!injection.items.topKey(injectedKey))
+      {
+        return true;
+      }
+    }
+
+    // evaluated without holding a queue lock, the key function may lock other things
+    if (m_keyFunction(item) <= injectedKey)
+    {
+      return true;
+    }
+
+    T injected;
+    if (popInjected(prio, injected))
+    {
+      WorkerQueue& own = *m_workers[workerIndex];
+      std::lock_guard<std::mutex> guard(own.mutex);
+      own.items[prio].push_back(std::move(item));
+      item = std::move(injected);
+    }
+    return true;
+  }
+
+  bool popInjected(size_t prio, T& item)
+  {
+    InjectionQueue& injection = m_injection[prio];
+    std::lock_guard<std::mutex> guard(injection.mutex);
+    return injection.items.pop(item);
+  }
+
+  void rekeyInjected(size_t prio)
+  {
+    InjectionQueue& injection = m_injection[prio];
+    const size_t generation = m_priorityGeneration;
+    if (injection.keyedGeneration.exchange(generation) != generation)
+    {
+      injection.items.rekey(injection.mutex, generation);
+    }
+  }
+
+  bool steal(size_t workerIndex, size_t prio, T& item)
+  {
+    const size_t count = m_workers.size();
+    for (size_t i = 1; i < count; i++)
+    {
+      WorkerQueue& victim = *m_workers[(workerIndex + i) % count];
+      std::unique_lock<std::mutex> guard(victim.mutex, std::try_to_lock);
+      if (!guard.owns_lock())
+      {
+        continue;  // busy -> try next one, we come back here in the next round anyway
+      }
+
+      auto& items = victim.items[prio];
+      if (!items.empty())
+      {
+        item = std::move(items.front());
+        items.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+};
+
+#endif // WORKSTEALINGSCHEDULER_HPP
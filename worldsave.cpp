@@ -8,23 +8,26 @@
  */
 
 #include "./worldsave.h"
-#include "./mapview.h"
 #include "./chunkrenderer.h"
+#include "./regionfilereader.h"
+#include "./resourcegovernor.h"
 #include "zlib/zlib.h"
 
-#include "chunkrenderer.h"
+#include <QScopedPointer>
 
-WorldSave::WorldSave(QString filename, MapView *map,
+WorldSave::WorldSave(QString filename, QString worldPath, const RenderSettings &settings,
                      bool regionChecker, bool chunkChecker,
                      int top, int left, int bottom, int right) :
   filename(filename),
-  map(map),
+  worldPath(worldPath),
+  settings(settings),
   top(top),
   left(left),
   bottom(bottom),
   right(right),
   regionChecker(regionChecker),
   chunkChecker(chunkChecker) {
+  this->settings.lod = 1;  // exports have one pixel per block, whatever the view is zoomed to
 }
 
 WorldSave::~WorldSave() {
@@ -54,8 +57,11 @@ static void writeChunk(QFile *f, const char *tag, const char *data,
 }
 
 void WorldSave::run() {
+  // export is a background job, the idle thread of the QThreadPool expires after the export
+  ResourceGovernor::Instance().applyBackgroundPriorityToCurrentThread();
+
   emit progress(tr("Calculating world bounds"), 0.0);
-  QString path = map->getWorldPath();
+  const QString path = worldPath;
 
   // convert from Blocks to Chunks
   top    = top/16;
@@ -103,39 +109,40 @@ void WorldSave::run() {
   strm.opaque = Z_NULL;
   deflateInit2(&strm, 6, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
 
+  // export reads the whole world once -> keep it out of the page cache
+  const RegionReadMode readMode = ResourceGovernor::Instance().getScanReadMode();
+  QScopedPointer<RegionFileReader> region;
+  int regionX = 0;
+  int regionZ = 0;
+
   double maximum = (bottom + 1 - top) * (right + 1 - left);
   double step = 0.0;
-  for (int z = top; z <= bottom; z++) {
-    for (int x = left; x <= right; x++, step += 1.0) {
-      emit progress(tr("Rendering world"), step / maximum);
-      int rx = x >> 5;
-      int rz = z >> 5;
-      QFile f(path + "/region/r." + QString::number(rx) + "." +
-              QString::number(rz) + ".mca");
-      if (!f.open(QIODevice::ReadOnly)) {
-        blankChunk(scanlines, width * 4 + 1, x - left);
-        continue;
-      }
-      uchar *header = f.map(0, 4096);
-      int offset = 4 * ((x & 31) + (z & 31) * 32);
-      int coffset = (header[offset] << 16) | (header[offset + 1] << 8) |
-          header[offset + 2];
-      int numSectors = header[offset + 3];
-      f.unmap(header);
-      if (coffset == 0) {
-        // no chunk here
-        blankChunk(scanlines, width * 4 + 1, x - left);
-      } else {
-        uchar *raw = f.map(coffset * 4096, numSectors * 4096);
-        NBT nbt(raw);
-        QSharedPointer<Chunk> chunk(new Chunk());
-        chunk->load(nbt);
-        f.unmap(raw);
-        drawChunk(scanlines, width * 4 + 1, x - left, chunk);
-        chunk.reset();
-      }
-      f.close();
+  auto loadChunk = [&](int x, int z) -> QSharedPointer<Chunk> {
+    emit progress(tr("Rendering world"), step / maximum);
+    step += 1.0;
+    int rx = x >> 5;
+    int rz = z >> 5;
+    if (!region || rx != regionX || rz != regionZ) {
+      region.reset(new RegionFileReader(path + "/region/r." + QString::number(rx) + "." +
+                                        QString::number(rz) + ".mca", readMode));
+      regionX = rx;
+      regionZ = rz;
     }
+    const QByteArray raw = region->readChunk(x & 31, z & 31);
+    if (raw.isEmpty())
+      return QSharedPointer<Chunk>();  // no chunk here, stays transparent
+    ResourceGovernor::Instance().throttleBackgroundIo(raw.size());
+    NBT nbt(reinterpret_cast<const uchar *>(raw.constData()));
+    QSharedPointer<Chunk> chunk(new Chunk());
+    chunk->load(nbt);
+    return chunk;
+  };
+
+  for (int z = top; z <= bottom; z++) {
+    // one row of chunks at a time, the whole world might not fit into RAM
+    QImage row;
+    ChunkRenderer::renderArea(settings, QRect(left, z, right + 1 - left, 1), loadChunk, row);
+    drawRow(scanlines, width * 4 + 1, row, z);
     // write out scanlines to disk
     strm.avail_in = insize;
     strm.next_in = scanlines;
@@ -284,37 +291,28 @@ void WorldSave::findBounds(QString path, int *top, int *left, int *bottom,
   *right = (edges[3].front().x * 32) + maxx;
 }
 
-// sets chunk to transparent
-void WorldSave::blankChunk(uchar *scanlines, int stride, int x) {
-  int offset = x * 16 * 4 + 1;
-  for (int y = 0; y < 16; y++, offset += stride)
-    memset(scanlines + offset, 0, 16 * 4);
-}
-
-void WorldSave::drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Chunk> chunk) {
-  // calculate attenuation
-  float attenuation = 1.0f;
-  if (this->regionChecker && static_cast<int>(floor(chunk->chunkX / 32.0f) +
-                                              floor(chunk->chunkZ / 32.0f)) % 2 != 0)
-    attenuation *= 0.9f;
-  if (this->chunkChecker && ((chunk->chunkX + chunk->chunkZ) % 2) != 0)
-    attenuation *= 0.9f;
-
-  // render chunk with current settings
-  QSharedPointer<RenderedChunk> renderedChunk = QSharedPointer<RenderedChunk>::create(chunk);
-  renderedChunk->init();
-
-  ChunkRenderer::renderChunk(*map, chunk, *renderedChunk);
-  // we can't memcpy each scanline because it's in BGRA format.
-  int offset = x * 16 * 4 + 1;
-  int ioffset = 0;
-  for (int y = 0; y < 16; y++, offset += stride) {
-    int xofs = offset;
-    for (int x = 0; x < 16; x++, xofs += 4) {
-      scanlines[xofs+2] = attenuation * renderedChunk->image.bits()[ioffset++];
-      scanlines[xofs+1] = attenuation * renderedChunk->image.bits()[ioffset++];
-      scanlines[xofs+0] = attenuation * renderedChunk->image.bits()[ioffset++];
-      scanlines[xofs+3] = attenuation * renderedChunk->image.bits()[ioffset++];
+// converts a rendered row of chunks to PNG scanlines
+void WorldSave::drawRow(uchar *scanlines, int stride, const QImage &row, int z) {
+  for (int x = left; x <= right; x++) {
+    // calculate attenuation
+    float attenuation = 1.0f;
+    if (this->regionChecker && static_cast<int>(floor(x / 32.0f) +
+                                                floor(z / 32.0f)) % 2 != 0)
+      attenuation *= 0.9f;
+    if (this->chunkChecker && ((x + z) % 2) != 0)
+      attenuation *= 0.9f;
+
+    // we can't memcpy each scanline because it's in BGRA format.
+    int offset = (x - left) * 16 * 4 + 1;
+    for (int y = 0; y < 16; y++, offset += stride) {
+      const uchar *bits = row.constScanLine(y) + (x - left) * 16 * 4;
+      int xofs = offset;
+      for (int i = 0; i < 16; i++, xofs += 4, bits += 4) {
+        scanlines[xofs+2] = attenuation * bits[0];
+        scanlines[xofs+1] = attenuation * bits[1];
+        scanlines[xofs+0] = attenuation * bits[2];
+        scanlines[xofs+3] = attenuation * bits[3];
+      }
     }
   }
 }
@@ -2,16 +2,17 @@
 #ifndef WORLDSAVE_H_
 #define WORLDSAVE_H_
 
+#include "./rendersettings.h"
+
 #include <QObject>
 #include <QRunnable>
 
-class MapView;
 class Chunk;
 
 class WorldSave : public QObject, public QRunnable {
   Q_OBJECT
  public:
-  WorldSave(QString filename, MapView *map,
+  WorldSave(QString filename, QString worldPath, const RenderSettings &settings,
             bool regionChecker = false, bool chunkChecker = false,
             int w_top = 0, int w_left = 0, int w_bottom = 0, int w_right = 0);
   ~WorldSave();
@@ -24,11 +25,11 @@ class WorldSave : public QObject, public QRunnable {
   void run();
 
  private:
-  void blankChunk(uchar *scanlines, int stride, int x);
-  void drawChunk(uchar *scanlines, int stride, int x, QSharedPointer<Chunk> chunk);
+  void drawRow(uchar *scanlines, int stride, const QImage &row, int z);
 
   QString filename;
-  MapView *map;
+  QString worldPath;
+  RenderSettings settings;
   int top;
   int left;
   int bottom;